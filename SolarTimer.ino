@@ -11,5 +11,9 @@
  * https://github.com/solamyl/SolarTimer
  */
 
+#include <avr/pgmspace.h>
+
 // version string, at least this file has some use...
-const char * appVersion = "SolarTimer v1.2.1";
+// (stored in flash, extern for being visible from the other modules)
+extern const char appVersion[] PROGMEM;
+const char appVersion[] PROGMEM = "SolarTimer v1.2.1";
@@ -11,110 +11,263 @@
  */
 
 #include <Arduino.h>
+#include <avr/interrupt.h>
 #include <avr/wdt.h>
 
 #include "config.h"
 #include "display.h"
 #include "globals.h"
+#include "log.h"
 
 
-// handle buttons
-// call often for being responsive
-void handleButtons()
+// buttons are sampled from timer0 compare B interrupt (every 1.024ms, timer0 runs for millis()),
+// pin change interrupts can not be used - all their vectors belong to SoftwareSerial
+// the same tick samples the DCF77 receiver (see dcf77.cpp)
+// pins: select=9 (PB1), plus=8 (PB0), minus=7 (PD7), active LOW with internal pull-ups
+
+// events in the queue, code of the pressed button is also its bit in the sample
+enum ButtonCode : uint8_t
+{
+    BTN_SELECT = 0,         // select pressed
+    BTN_PLUS,               // plus pressed or autorepeated
+    BTN_MINUS,              // minus pressed or autorepeated
+    BTN_COUNT,
+    BTN_RESET = BTN_COUNT,  // select held for resetHoldTicks
+    BTN_RELEASED = 0x80,    // flag: button released
+};
+
+// one timestamped event
+struct ButtonEvent_s
 {
-    //Serial.println("handleButtons()");
-    unsigned long nowTS = millis();
+    uint8_t code;   // ButtonCode
+    uint16_t ts;    // millis() of the event (lower 16 bits)
+};
 
-    buttonSelect.read();
-    buttonPlus.read();
-    buttonMinus.read();
-    detectReset.read();
+// timer ticks from msecs (tick is 1.024ms)
+constexpr uint16_t msToTicks(uint16_t ms)
+{
+    return static_cast<uint32_t>(ms) * 125u / 128u;
+}
+// state must be stable for this time to be accepted
+constexpr uint8_t debounceTicks = msToTicks(10);
+// autorepeat of plus/minus
+constexpr uint16_t repeatDelayTicks = msToTicks(1000);
+constexpr uint16_t repeatRateTicks = msToTicks(100);
+// long press of select for reset
+constexpr uint16_t resetHoldTicks = msToTicks(3000);
 
-    // == RESET ==
-    if (detectReset.wasPressed()) {
-        Serial.println("[RESET]");
+// single producer (interrupt), single consumer (handleButtons()) queue, lock-free
+// each index is written by one side only, size must be power of 2
+constexpr uint8_t buttonQueueSize = 8;
+ButtonEvent_s buttonQueue[buttonQueueSize];
+volatile uint8_t buttonHead = 0;    // next write, written by the interrupt
+volatile uint8_t buttonTail = 0;    // next read, written by handleButtons()
 
-        lcd.noBacklight(); //give sign of reset activation
+// debounced state of the buttons (bit per ButtonCode, 1=pressed)
+uint8_t buttonState = 0;
+// number of ticks the sample differs from buttonState
+uint8_t buttonBounce[BTN_COUNT];
+// countdown to the next autorepeat (plus/minus) or to the reset (select), 0=stopped
+uint16_t buttonTimer[BTN_COUNT];
 
-        rtc.set(0, 0, 0, 6, 1, 1, 0); //reset rtc
-        rtc.lostPowerClear();
+// config edited by held +/-, the change is announced after release
+bool buttonEditPending = false;
 
-        config = Config_s(); //reset config with defaults
-        config.updateCrc();
-        config.saveData();
+// stats: the worst time from the event to its handling (msec)
+uint16_t buttonLatencyMax = 0;
+// stats: events lost because the queue was full
+uint8_t buttonEventsLost = 0;
 
-        //Serial.println("!! Configuration and RTC was set to defaults !!");
-        Serial.print("Config and RTC");
-        Serial.print(" - resetting!");
-        Serial.println();
-        Serial.print("Restarting");
-        delay(1);
 
-        // this should cause the device reboot
-        wdt_enable(WDTO_15MS);   // shortest timeout
 
-        while (true) {
-            Serial.print(".");
-            delay(1);
-        }
-        // this place should be never reached
+// read all buttons at once (two ports), bit per ButtonCode, 1=pressed
+inline uint8_t buttonSample()
+{
+    uint8_t b = ~PINB;
+    uint8_t d = ~PIND;
+    return ((b >> 1) & 0x01) << BTN_SELECT
+            | (b & 0x01) << BTN_PLUS
+            | ((d >> 7) & 0x01) << BTN_MINUS;
+}
+
+
+// add event into the queue (called from the interrupt)
+void buttonPush(uint8_t code)
+{
+    uint8_t head = buttonHead;
+    uint8_t next = (head + 1) & (buttonQueueSize - 1);
+    if (next == buttonTail) {
+        ++buttonEventsLost; //full
+        return;
     }
+    buttonQueue[head].code = code;
+    buttonQueue[head].ts = millis();
+    asm volatile("" ::: "memory"); //event must be written before it is published
+    buttonHead = next;
+}
 
-    // == SELECT ==
-    if (buttonSelect.wasPressed()) {
-        Serial.println("[SEL]");
-        backlightTS = nowTS;
-        refreshScreen = true; //refresh always after keypress
 
-        if (!backlightOn) {
-            // just light up the display
+// take event from the queue
+// returns: true=event copied into ev, false=queue is empty
+bool buttonPop(ButtonEvent_s& ev)
+{
+    uint8_t tail = buttonTail;
+    if (tail == buttonHead)
+        return false;
+    asm volatile("" ::: "memory"); //read event after its publishing was seen
+    ev = buttonQueue[tail];
+    asm volatile("" ::: "memory"); //event must be read before its slot is released
+    buttonTail = (tail + 1) & (buttonQueueSize - 1);
+    return true;
+}
+
+
+// sample, debounce and autorepeat the buttons
+ISR(TIMER0_COMPB_vect)
+{
+    uint8_t changed = buttonSample() ^ buttonState;
+
+    for (uint8_t i = 0; i < BTN_COUNT; ++i) {
+        uint8_t bit = 1 << i;
+
+        // debounce: accept the new state after it is stable for debounceTicks
+        if (changed & bit) {
+            if (++buttonBounce[i] >= debounceTicks) {
+                buttonBounce[i] = 0;
+                buttonState ^= bit;
+                if (buttonState & bit) {
+                    buttonPush(i);
+                    buttonTimer[i] = i == BTN_SELECT ? resetHoldTicks : repeatDelayTicks;
+                }
+                else {
+                    buttonPush(i | BTN_RELEASED);
+                    buttonTimer[i] = 0;
+                }
+            }
+            continue;
         }
-        else {
-            nextScreen(); //advance to the next screen
+        buttonBounce[i] = 0;
+
+        // held: autorepeat or reset
+        if (buttonTimer[i] && --buttonTimer[i] == 0) {
+            if (i == BTN_SELECT) {
+                buttonPush(BTN_RESET);
+            }
+            else {
+                buttonPush(i);
+                buttonTimer[i] = repeatRateTicks;
+            }
         }
     }
 
-    uint8_t scr = getActiveScreen();
+#if DCF77
+    dcfSample();
+#endif
+}
 
-    // == PLUS ==
-    if (buttonPlus.wasPressed()) {
-        Serial.println("[+]");
-        backlightTS = nowTS;
-        refreshScreen = true; //refresh always after keypress
-    
-        if (!backlightOn) {
-            // just light up the display
-        }
-        else if (scr == 0x11) {
-            config.switchSunAltitude_x10 += 1;
-            if (config.switchSunAltitude_x10 > 900)
-                config.switchSunAltitude_x10 = 900;
-        }
-        else if (scr == 0x12) {
-            config.switchTimeDelay += 10;
-            if (config.switchTimeDelay > 990)
-                config.switchTimeDelay = 990;
-        }
+
+// set button pins and start sampling
+void initButtons()
+{
+    pinMode(9, INPUT_PULLUP);
+    pinMode(8, INPUT_PULLUP);
+    pinMode(7, INPUT_PULLUP);
+    delay(1);
+    buttonState = buttonSample(); //button held during boot is not a press
+
+    // compare B in the middle of timer0 cycle, OC0B pin (D5) stays disconnected
+    OCR0B = 0x80;
+    TIMSK0 |= _BV(OCIE0B);
+}
+
+
+// reset config and rtc to defaults and reboot
+void resetAll()
+{
+    LOG_I("[RESET]");
+
+    lcdBacklight(false); //give sign of reset activation
+
+    rtc.set(0, 0, 0, 6, 1, 1, 0); //reset rtc
+    rtc.lostPowerClear();
+
+    config = Config_s(); //reset config with defaults
+    config.updateCrc();
+    config.saveData();
+    logEvent(EV_CONFIG_RESET, 1);
+    eventLogFlush(true);
+
+    //Serial.println("!! Configuration and RTC was set to defaults !!");
+    LOG_I("Config and RTC - resetting!");
+    Serial.print(F("Restarting"));
+    delay(1);
+
+    // this should cause the device reboot
+    wdt_enable(WDTO_15MS);   // shortest timeout
+
+    while (true) {
+        Serial.print(".");
+        delay(1);
     }
+    // this place should be never reached
+}
+
+
+// handle button events from the queue
+// presses are captured by the interrupt, so nothing is missed while other tasks run
+void handleButtons()
+{
+    ButtonEvent_s ev;
+    while (buttonPop(ev)) {
+        unsigned long nowTS = millis();
+        uint16_t latency = static_cast<uint16_t>(nowTS) - ev.ts;
+        if (latency > buttonLatencyMax)
+            buttonLatencyMax = latency;
+
+        if (ev.code & BTN_RELEASED) {
+            // editing finished - full recalc and save
+            if (ev.code != (BTN_SELECT | BTN_RELEASED) && buttonEditPending) {
+                buttonEditPending = false;
+                configChanged();
+            }
+            continue;
+        }
+
+        // == RESET ==
+        if (ev.code == BTN_RESET)
+            resetAll();
 
-    // == MINUS ==
-    if (buttonMinus.wasPressed()) {
-        Serial.println("[-]");
         backlightTS = nowTS;
         refreshScreen = true; //refresh always after keypress
 
-        if (!backlightOn) {
-            // just light up the display
+        if (!backlightOn)
+            continue; // just light up the display
+
+        // == SELECT ==
+        if (ev.code == BTN_SELECT) {
+            LOG_D("[SEL]");
+            nextScreen(); //advance to the next screen
+            continue;
         }
-        else if (scr == 0x11) {
-            config.switchSunAltitude_x10 -= 1;
-            if (config.switchSunAltitude_x10 < -900)
-                config.switchSunAltitude_x10 = -900;
+
+        // == PLUS / MINUS ==
+        int8_t step = ev.code == BTN_PLUS ? +1 : -1;
+        LOG_D("[%c]", step > 0 ? '+' : '-');
+
+        // while the button is held only the preview of the schedule is updated,
+        // config change is announced at the release
+        uint8_t scr = getActiveScreen();
+        ChannelConfig_s& cfg = config.channel[displayChannel];
+        if (scr == 0x11) {
+            cfg.sunAltitude_x10 = constrain(cfg.sunAltitude_x10 + step, -900, 900);
+            config.updateCrc();
+            previewSwitchTimes(displayChannel);
+            buttonEditPending = true;
         }
         else if (scr == 0x12) {
-            config.switchTimeDelay -= 10;
-            if (config.switchTimeDelay < 0)
-                config.switchTimeDelay = 0;
+            cfg.timeDelay = constrain(cfg.timeDelay + step * 10, 0, 990);
+            config.updateCrc();
+            buttonEditPending = true;
         }
-    }  
+    }
 }
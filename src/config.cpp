@@ -12,38 +12,97 @@
 
 #include <Arduino.h>
 
+#include <Wire.h>
 #include <at24c32.h>
 
 #include "globals.h"
 #include "config.h"
+#include "log.h"
 
 
 // app configuration
 Config_s config;
 
+// quiet period after the last change before the config is written into eeprom (msec)
+constexpr unsigned long configQuietPeriod = 5000ul;
 
+// config in RAM differs from eeprom
+bool configDirty = false;
+// timestamp of the last change of config (millis())
+unsigned long configChangedTS = 0;
+// stats: number of eeprom writes avoided by coalescing config changes
+unsigned long configWritesSaved = 0;
+// incremented on every change of config
+uint8_t configGeneration = 0;
 
-// calc crc16 checksum (CCITT 0xffff)
+
+
+// one record of the config journal in eeprom
+template <typename T>
+struct JournalRecord_s
+{
+    uint16_t seq;   // sequence number, the highest one (in wrap-around sense) is the newest
+    T data;
+    uint16_t crc;   // crc16 of seq and data
+};
+typedef JournalRecord_s<Config_s> ConfigRecord_s;
+
+// records start at page boundaries, a record may take more pages
+constexpr uint16_t configSlotSize = (sizeof(ConfigRecord_s) + eepromPageSize - 1) / eepromPageSize * eepromPageSize;
+constexpr uint8_t configJournalSlots = configJournalSize / configSlotSize;
+static_assert(configJournalSlots >= 2, "config journal needs at least 2 slots");
+
+// config of the firmware before switch channels (single output), migrated by loadData()
+struct ConfigV1_s
+{
+    uint16_t crc16;
+    float latitude;
+    float longitude;
+    float hdop;
+    int16_t switchSunAltitude_x10; //int of avr
+    int16_t switchTimeDelay;
+};
+
+// journal slot holding the newest record
+// (first write goes to slot 1, so config of older firmware at address 0 survives it)
+uint8_t configSlot = 0;
+// sequence number of the newest record
+uint16_t configSeq = 0;
+
+
+
+// crc16 CCITT (poly 0x1021) of all 4bit values, for processing the data nibble by nibble
+const uint16_t crc16Table[16] PROGMEM = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+
+// calc crc16 checksum (CCITT 0xffff) of the data
+// crc - value to continue with (for data split into more pieces)
+// table driven by nibbles, gives the same results as the former bitwise version:
 // src:  https://stackoverflow.com/questions/10564491/function-to-calculate-a-crc16-checksum
 // test: https://www.lammertbies.nl/comm/info/crc-calculation
 //
-uint16_t Config_s::calcCrc16() const
+uint16_t crc16(const uint8_t * data, unsigned int length, uint16_t crc)
 {
-    const uint8_t *data_p = reinterpret_cast<const uint8_t *>(this) + sizeof(Config_s::crc16);
-    unsigned int length = sizeof(Config_s) - sizeof(Config_s::crc16);
-    
-    uint16_t crc = 0xffff;
-    uint8_t x;
-
     while (length--) {
-        x = (crc >> 8) ^ *(data_p++);
-        x ^= x >> 4;
-        crc = (crc << 8) ^ (static_cast<uint16_t>(x) << 12) ^ (static_cast<uint16_t>(x) << 5) ^ (static_cast<uint16_t>(x));
+        uint8_t x = *(data++);
+        crc = (crc << 4) ^ pgm_read_word(&crc16Table[(crc >> 12) ^ (x >> 4)]);
+        crc = (crc << 4) ^ pgm_read_word(&crc16Table[(crc >> 12) ^ (x & 0x0f)]);
     }
     return crc;
 }
 
 
+// calc crc16 of the struct content (without the crc itself)
+uint16_t Config_s::calcCrc16() const
+{
+    return ::crc16(reinterpret_cast<const uint8_t *>(this) + sizeof(Config_s::crc16),
+            sizeof(Config_s) - sizeof(Config_s::crc16));
+}
+
+
 // checks if the checksum matches the stored content in the struct. 0=does not match, 1=match OK
 bool Config_s::isCrcValid() const
 {
@@ -58,24 +117,235 @@ void Config_s::updateCrc()
 }
 
 
-// loads data from eeprom
+// check crc of config data, the crc is stored in its first member "crc16"
+template <typename T>
+bool dataCrcValid(const T& data)
+{
+    return data.crc16 == ::crc16(reinterpret_cast<const uint8_t *>(&data) + sizeof(data.crc16),
+            sizeof(T) - sizeof(data.crc16));
+}
+
+
+// find the newest valid record in the journal
+// slotSize - distance of the records in eeprom
+// returns: slot of the newest record (copied into newest), -1=no valid record, -2=read error
+template <typename T>
+int8_t journalFind(JournalRecord_s<T>& newest, uint16_t slotSize)
+{
+    JournalRecord_s<T> rec;
+    int8_t found = -1;
+
+    for (uint8_t slot = 0; slot < configJournalSize / slotSize; ++slot) {
+        int n = eeprom.readBuffer(configJournalAddr + slot * slotSize,
+                reinterpret_cast<uint8_t *>(&rec), sizeof(rec));
+        if (n != sizeof(rec))
+            return -2;
+
+        // torn or empty record
+        if (rec.crc != ::crc16(reinterpret_cast<const uint8_t *>(&rec), sizeof(rec) - sizeof(rec.crc)))
+            continue;
+        if (!dataCrcValid(rec.data))
+            continue;
+
+        // keep the newest one (sequence number can wrap around)
+        if (found < 0 || static_cast<int16_t>(rec.seq - newest.seq) > 0) {
+            found = slot;
+            newest = rec;
+        }
+    }
+    return found;
+}
+
+
+// loads the newest valid record from the eeprom journal
+// config of older firmware is migrated (and moved into the journal by the next saveData())
 // returns: 0=OK data valid, -1=error
 int Config_s::loadData()
 {
-    int n = eeprom.readBuffer(0, reinterpret_cast<uint8_t *>(&config), sizeof(config));
-    if (n != sizeof(config))
+    ConfigRecord_s rec;
+    int8_t found = journalFind(rec, configSlotSize);
+    if (found == -2)
         return -1;
-    return isCrcValid() ? 0 : -1;
+    if (found >= 0) {
+        *this = rec.data;
+        configSlot = found;
+        configSeq = rec.seq;
+        return 0;
+    }
+
+    // no record of this version, try the journal of single output firmware
+    JournalRecord_s<ConfigV1_s> old;
+    found = journalFind(old, eepromPageSize);
+    if (found == -2)
+        return -1;
+    if (found < 0) {
+        // no journal at all, try config stored by even older firmware directly at address 0
+        int n = eeprom.readBuffer(0, reinterpret_cast<uint8_t *>(&old.data), sizeof(old.data));
+        if (n != sizeof(old.data) || !dataCrcValid(old.data))
+            return -1;
+        old.seq = 0;
+        found = 0;
+    }
+
+    *this = Config_s();
+    latitude = old.data.latitude;
+    longitude = old.data.longitude;
+    hdop = old.data.hdop;
+    channel[0].sunAltitude_x10 = old.data.switchSunAltitude_x10;
+    channel[0].timeDelay = old.data.switchTimeDelay;
+    updateCrc();
+
+    // continue behind the old record, so it is not overwritten by the next write
+    configSlot = found * eepromPageSize / configSlotSize;
+    configSeq = old.seq;
+    return 0;
 }
 
 
-// saves data to eeprom
+// saves data to the next slot of the eeprom journal
+// the newest valid record is never overwritten, so a power loss during the write
+// leaves a torn record which is skipped by loadData()
 // returns: 0=OK, -1=error
 int Config_s::saveData() const
 {
-    int n = eeprom.writeBuffer(0, reinterpret_cast<uint8_t *>(&config), sizeof(config));
-    if (n != sizeof(config))
+    ConfigRecord_s rec;
+    rec.seq = configSeq + 1;
+    rec.data = *this;
+    rec.crc = ::crc16(reinterpret_cast<const uint8_t *>(&rec), sizeof(rec) - sizeof(rec.crc));
+
+    uint8_t slot = (configSlot + 1) % configJournalSlots;
+    if (eepromWrite(configJournalAddr + slot * configSlotSize, reinterpret_cast<const uint8_t *>(&rec), sizeof(rec)) < 0)
+        return -1;
+
+    configSlot = slot;
+    configSeq = rec.seq;
+    return 0;
+}
+
+
+// wait for the end of the eeprom internal write cycle
+// eeprom does not ACK its address until the write is done (max 10ms)
+// returns: 0=OK, -1=timeout
+int eepromWaitReady()
+{
+    unsigned long startTS = millis();
+    do {
+        Wire.beginTransmission(eepromI2cAddr);
+        if (Wire.endTransmission() == 0)
+            return 0;
+    }
+    while (millis() - startTS < 20);
+    return -1;
+}
+
+
+// length of the next piece written at once: up to the page boundary and what fits
+// into twi buffer with 2 address bytes
+uint8_t eepromPiece(uint16_t addr, uint16_t length)
+{
+    uint16_t n = eepromPageSize - (addr % eepromPageSize);
+    if (n > BUFFER_LENGTH - 2)
+        n = BUFFER_LENGTH - 2;
+    if (n > length)
+        n = length;
+    return n;
+}
+
+
+// write data into eeprom, split into page writes, wait for each write cycle by ACK polling
+// returns: 0=OK, -1=error
+int eepromWrite(uint16_t addr, const uint8_t * data, uint16_t length)
+{
+    while (length > 0) {
+        uint8_t n = eepromPiece(addr, length);
+
+        Wire.beginTransmission(eepromI2cAddr);
+        Wire.write(static_cast<uint8_t>(addr >> 8));
+        Wire.write(static_cast<uint8_t>(addr & 0xff));
+        Wire.write(data, n);
+        if (Wire.endTransmission() != 0)
+            return -1;
+        if (eepromWaitReady() < 0)
+            return -1;
+
+        addr += n;
+        data += n;
+        length -= n;
+    }
+    return 0;
+}
+
+
+// compare data with eeprom content, the bytes are checked straight in the twi buffer
+// returns: true=same, false=different or read error
+bool eepromSame(uint16_t addr, const uint8_t * data, uint8_t n)
+{
+    Wire.beginTransmission(eepromI2cAddr);
+    Wire.write(static_cast<uint8_t>(addr >> 8));
+    Wire.write(static_cast<uint8_t>(addr & 0xff));
+    if (Wire.endTransmission() != 0 || Wire.requestFrom(eepromI2cAddr, n) != n)
+        return false;
+
+    bool same = true;
+    for (uint8_t i = 0; i < n; ++i) {
+        if (Wire.read() != data[i])
+            same = false;
+    }
+    return same;
+}
+
+
+// write only the pieces of data that differ from eeprom content (saves write cycles and wear)
+// returns: 0=OK nothing written, +1=OK written, -1=error
+int eepromUpdate(uint16_t addr, const uint8_t * data, uint16_t length)
+{
+    int result = 0;
+    while (length > 0) {
+        uint8_t n = eepromPiece(addr, length);
+        if (!eepromSame(addr, data, n)) {
+            if (eepromWrite(addr, data, n) < 0)
+                return -1;
+            result = +1;
+        }
+        addr += n;
+        data += n;
+        length -= n;
+    }
+    return result;
+}
+
+
+// config was changed in RAM, schedule its saving into eeprom (write-behind)
+void configChanged()
+{
+    config.updateCrc();
+    ++configGeneration;
+
+    if (configDirty)
+        ++configWritesSaved; //previous change was not written yet and never will be
+    configDirty = true;
+    configChangedTS = millis();
+}
+
+
+// save the changed config into eeprom after a quiet period since the last change
+// inputs: force - save now if there is anything to save
+// returns: 0=OK or nothing to do, -1=error
+int configCommit(bool force)
+{
+    if (!configDirty)
+        return 0;
+    if (!force && millis() - configChangedTS < configQuietPeriod)
+        return 0; //still changing, wait
+    
+    if (config.saveData() != 0) {
+        configChangedTS = millis(); //stays dirty, retry after another quiet period
+        LOG_E("config: save failed");
         return -1;
+    }
+    configDirty = false;
+    LOG_I("config: saved, writes avoided %lu", configWritesSaved);
+    config.debugPrint();
     return 0;
 }
 
@@ -93,10 +363,12 @@ void Config_s::debugPrint() const
     Serial.print(longitude, 6);
     Serial.print(", hdop=");
     Serial.print(hdop);
-    Serial.print(", sunAlt=");
-    Serial.print(switchSunAltitude_x10 / 10.0);
-    Serial.print(", delay=");
-    Serial.print(switchTimeDelay);
+    for (uint8_t ch = 0; ch < SWITCH_CHANNELS; ++ch) {
+        Serial.print(", sunAlt=");
+        Serial.print(channel[ch].sunAltitude_x10 / 10.0);
+        Serial.print(", delay=");
+        Serial.print(channel[ch].timeDelay);
+    }
     Serial.println("}");*/
 }
 
@@ -107,7 +379,7 @@ int testEeprom()
 {
     unsigned long nowTS = millis();
 
-    int idx = sizeof(Config_s); //write directly after the config struct
+    int idx = eepromScratchAddr;
     uint8_t val = nowTS & 0xff;
 
     eeprom.write(idx, val);
@@ -14,6 +14,37 @@
 #ifndef __CONFIG_H__
 #define __CONFIG_H__
 
+#include "switch.h"
+
+
+// eeprom (AT24C32) i2c address
+constexpr uint8_t eepromI2cAddr = 0x57;
+// eeprom page size, page write must not cross the page boundary
+constexpr uint16_t eepromPageSize = 32;
+
+// eeprom memory map:
+// config journal - records rotate through slots of whole pages (see config.cpp)
+constexpr uint16_t configJournalAddr = 0x0000;
+constexpr uint16_t configJournalSize = 0x0100;
+// scratch byte for testEeprom()
+constexpr uint16_t eepromScratchAddr = 0x0100;
+// event log - ring of 8 byte records (see eventlog.cpp)
+constexpr uint16_t eventLogAddr = 0x0200;
+constexpr uint16_t eventLogSize = 0x0400;
+// gps receiver backup - almanac and ephemeris records, ttff stats (see gpsbackup.cpp)
+constexpr uint16_t gpsBackupAddr = 0x0600;
+constexpr uint16_t gpsBackupSize = 0x0a00;
+
+
+// settings of one switch channel
+struct ChannelConfig_s
+{
+    // switch lights on when sun the is lower than this (in tenth of degs)
+    int16_t sunAltitude_x10;
+    // delay switching the switch by this number of seconds
+    int16_t timeDelay;
+};
+
 
 struct Config_s
 {
@@ -23,18 +54,21 @@ struct Config_s
     float latitude;
     float longitude;
     float hdop;
-    // switch lights on when sun the is lower than this (in tenth of degs)
-    int switchSunAltitude_x10;
-    // delay switching the switch by this number of seconds
-    int switchTimeDelay;
+    // settings of the switch channels
+    ChannelConfig_s channel[SWITCH_CHANNELS];
 
 protected:
     uint16_t calcCrc16() const;
 
 public:
     // default values in default constructor
-    Config_s() : crc16(0), latitude(0.0), longitude(0.0), hdop(-1.0), switchSunAltitude_x10(-20), switchTimeDelay(0)
+    // (first channel -2 degs for decorative lights, the others -6 degs for street lights)
+    Config_s() : crc16(0), latitude(0.0), longitude(0.0), hdop(-1.0)
     {
+        for (uint8_t ch = 0; ch < SWITCH_CHANNELS; ++ch) {
+            channel[ch].sunAltitude_x10 = ch == 0 ? -20 : -60;
+            channel[ch].timeDelay = 0;
+        }
     }
 
     // checks if content of the struct matches the checksum. 0=does not match, 1=match OK
@@ -43,10 +77,10 @@ public:
     // update the stored checksum to match the config structure content
     void updateCrc();
 
-    // loads data from eeprom
+    // loads the newest valid record from the eeprom journal
     // returns: 0=OK data valid, -1=error
     int loadData();
-    // saves data to eeprom
+    // saves data to the next slot of the eeprom journal
     // returns: 0=OK, -1=error
     int saveData() const;
 
@@ -58,6 +92,32 @@ public:
 // app configuration
 extern Config_s config;
 
+// stats: number of eeprom writes avoided by coalescing config changes
+extern unsigned long configWritesSaved;
+
+// incremented on every change of config, cheap way to detect changes
+extern uint8_t configGeneration;
+
+// config was changed in RAM, schedule its saving into eeprom (write-behind)
+// must be called after every modification of config
+void configChanged();
+// save the changed config into eeprom after a quiet period since the last change
+// inputs: force - save now if there is anything to save
+// returns: 0=OK or nothing to do, -1=error
+int configCommit(bool force = false);
+
+
+// calc crc16 checksum (CCITT 0xffff) of the data
+// crc - value to continue with (for data split into more pieces)
+uint16_t crc16(const uint8_t * data, unsigned int length, uint16_t crc = 0xffff);
+
+// write data into eeprom, split into page writes, wait for each write cycle by ACK polling
+// returns: 0=OK, -1=error
+int eepromWrite(uint16_t addr, const uint8_t * data, uint16_t length);
+
+// write only the pieces of data that differ from eeprom content (saves write cycles and wear)
+// returns: 0=OK nothing written, +1=OK written, -1=error
+int eepromUpdate(uint16_t addr, const uint8_t * data, uint16_t length);
 
 // test if eeprom is working
 // return: 0=OK, -1=error, or >0 errors from getLastError()
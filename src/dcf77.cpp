@@ -0,0 +1,106 @@
+/*
+ * DCF77 radio time - second time source for the rtc
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+
+#include <uRTCLib.h>
+
+#include "DateTime.h"
+#include "dcf77.h"
+#include "globals.h"
+#include "log.h"
+#include "timesource.h"
+
+
+#if DCF77
+
+// receiver output is sampled from the button tick (timer0 compare B, see buttons.cpp),
+// the pulse widths are counted in ticks, nothing waits for the edges
+Dcf77Decoder dcf;
+// input register and bit of the receiver pin
+volatile uint8_t* dcfPort;
+uint8_t dcfMask;
+// millis() at the minute mark of the ready frame (lower 16 bits)
+volatile uint16_t dcfMarkTS;
+
+// utc minutes of the last decoded frame, next frame must follow it
+uint32_t dcfLastMinutes = 0;
+// number of consecutive valid frames (confidence of the time)
+uint8_t dcfConsecutive = 0;
+
+// stats: complete frames received
+uint16_t dcfFrames = 0;
+// stats: frames rejected by parity or range checks
+uint16_t dcfErrors = 0;
+
+
+
+// set the receiver pin
+void initDcf()
+{
+    pinMode(DCF77_PIN, INPUT_PULLUP); //receivers have open collector output
+    dcfPort = portInputRegister(digitalPinToPort(DCF77_PIN));
+    dcfMask = digitalPinToBitMask(DCF77_PIN);
+}
+
+
+// feed one sample to the decoder, called from the timer interrupt
+void dcfSample()
+{
+    bool in = (*dcfPort & dcfMask) != 0;
+    if (dcf.sample(in == DCF77_PULSE_LEVEL))
+        dcfMarkTS = millis() - dcfMarkDelay;
+}
+
+
+// offer the time of the received frame to the arbiter (RTC)
+// its score grows with the number of consecutive frames
+// returns: 0=rtc set, -1=no valid frame, +1=rtc not set
+int dcfSync(const DateTime& nowUtc)
+{
+    if (!dcf.ready)
+        return -1;
+    asm volatile("" ::: "memory"); //read the frame after the flag
+
+    noInterrupts();
+    uint16_t markTS = dcfMarkTS;
+    interrupts();
+
+    DcfTime_s t;
+    int8_t err = dcfDecode(dcf.bits, t);
+    dcf.ready = false;
+    ++dcfFrames;
+    if (err) {
+        ++dcfErrors;
+        LOG_D("dcf: bad frame");
+        dcfConsecutive = 0;
+        return -1;
+    }
+
+    uint32_t minutes = dcfUtcMinutes(t);
+    if (minutes == dcfLastMinutes + 1) {
+        if (dcfConsecutive < 0xff)
+            ++dcfConsecutive;
+    }
+    else {
+        dcfConsecutive = 1;
+    }
+    dcfLastMinutes = minutes;
+    LOG_D("dcf: %02u:%02u %u.%u.%u (%u)", t.hour, t.minute, t.day, t.month, t.year, dcfConsecutive);
+
+    // the frame is the minute starting at the mark
+    uint16_t elapsed = static_cast<uint16_t>(millis()) - markTS;
+    DateTime dcfNow(946684800ul/*2000-01-01*/ + minutes * 60ul + (elapsed + 500u) / 1000u);
+    return timeOffer(TS_DCF77, timeDcfScore(dcfConsecutive), dcfNow, nowUtc);
+}
+
+#endif // DCF77
@@ -0,0 +1,242 @@
+/*
+ * DCF77 time signal decoder - pulse widths to the minute frame
+ * no Arduino dependency, so the same code runs in tools/dcf77_sim.cpp
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#pragma once
+#ifndef __DCF77_H__
+#define __DCF77_H__
+
+#include <stdint.h>
+
+
+// DCF77 sends one pulse (carrier reduction) every second, 100ms=bit 0, 200ms=bit 1,
+// the pulse of second 59 is missing - the next pulse starts the minute encoded in the frame
+
+// length of one sample (usecs), samples come from the timer0 tick on arduino
+#ifndef DCF77_TICK_US
+#define DCF77_TICK_US 1024
+#endif
+
+// samples from msecs
+constexpr uint16_t dcfTicks(uint16_t ms)
+{
+    return static_cast<uint32_t>(ms) * 1000u / DCF77_TICK_US;
+}
+
+// level must be stable for this time to be accepted (both edges are delayed the same,
+// so the pulse widths are preserved)
+constexpr uint8_t dcfFilterTicks = dcfTicks(20);
+// pulse widths (time of the high level in the pulse window), 0 below dcfOneMin
+constexpr uint16_t dcfZeroMin = dcfTicks(40);
+constexpr uint16_t dcfOneMin = dcfTicks(150);
+constexpr uint16_t dcfPulseWindow = dcfTicks(260);
+// distance of the pulse starts, normal second and the minute mark
+constexpr uint16_t dcfSecondMin = dcfTicks(900);
+constexpr uint16_t dcfSecondMax = dcfTicks(1100);
+constexpr uint16_t dcfMarkMin = dcfTicks(1800);
+constexpr uint16_t dcfMarkMax = dcfTicks(2200);
+// number of bits of the frame (leap second minute with 60 bits is dropped)
+constexpr uint8_t dcfFrameBits = 59;
+// minute is not being received (waiting for the minute mark)
+constexpr uint8_t dcfNoFrame = 0xff;
+
+
+// pulse decoder, fed by one sample every tick
+// a pulse start is taken only where the next second (or the minute mark) is expected, so
+// noise between the pulses is ignored. the second is evaluated at the end of the pulse
+// window - the width is the high time inside it, so dropouts and spikes around the pulse
+// shift it only a little, and a start without a real pulse (spike) is taken back
+// bits of the finished frame stay untouched until bit 17 of the next one, so the consumer
+// has 17 secs to take them (bits 0-16 carry no time information)
+struct Dcf77Decoder
+{
+    uint8_t bits[8];                // bit N of the frame is bits[N / 8] & (1 << N % 8)
+    uint8_t count = dcfNoFrame;     // bits received since the minute mark, dcfNoFrame=error
+    uint16_t ticks = 0xffff;        // ticks since the start of the second (pulse start)
+    uint16_t period = 0;            // ticks from the previous start to this one
+    uint16_t width = 0;             // high ticks in the pulse window of this second
+    uint8_t filter = 0;             // noise integrator (0..dcfFilterTicks)
+    bool level = false;             // filtered input, true=pulse
+    volatile bool ready = false;    // complete frame in bits (set in the isr), cleared by the consumer
+
+    // feed one sample
+    // in - true=pulse (carrier reduced)
+    // returns: true=complete frame, its minute started (dcfMarkDelay) ago
+    bool sample(bool in)
+    {
+        if (ticks < 0xffff)
+            ++ticks;
+
+        if (in) {
+            if (filter < dcfFilterTicks)
+                ++filter;
+        }
+        else if (filter > 0) {
+            --filter;
+        }
+        bool l = level ? filter > 0 : filter >= dcfFilterTicks;
+
+        // == pulse start ==
+        if (l && !level) {
+            if (ticks >= dcfSecondMin) {
+                period = ticks;
+                ticks = 0;
+                width = 0;
+            }
+            else if (ticks < dcfPulseWindow && width < dcfZeroMin) {
+                // the second was started by a spike, the pulse starts here
+                period += ticks;
+                ticks = 0;
+                width = 0;
+            }
+            //else noise or dropout inside the second
+        }
+        level = l;
+
+        if (ticks < dcfPulseWindow) {
+            if (level)
+                ++width;
+            return false;
+        }
+        if (ticks == dcfPulseWindow)
+            return endOfPulse();
+        return false;
+    }
+
+    // evaluate the second at the end of its pulse window
+    // returns: true=complete frame
+    bool endOfPulse()
+    {
+        if (width < dcfZeroMin) {
+            // no pulse - the start was a spike, continue the previous second
+            uint32_t t = static_cast<uint32_t>(ticks) + period;
+            ticks = t < 0xffff ? t : 0xffff;
+            return false;
+        }
+
+        bool complete = false;
+        if (period >= dcfMarkMin && period <= dcfMarkMax) {
+            complete = count == dcfFrameBits;
+            if (complete)
+                ready = true;
+            count = 0;
+        }
+        else if (period < dcfSecondMin || period > dcfSecondMax) {
+            count = dcfNoFrame; //lost, wait for the next minute
+        }
+
+        if (count < dcfFrameBits) {
+            uint8_t mask = 1 << (count & 7);
+            if (width < dcfOneMin)
+                bits[count >> 3] &= ~mask;
+            else
+                bits[count >> 3] |= mask;
+            ++count;
+        }
+        else {
+            count = dcfNoFrame; //too many bits
+        }
+        return complete;
+    }
+};
+
+// time from the start of the minute to the report of the complete frame (msecs)
+constexpr uint16_t dcfMarkDelay = static_cast<uint32_t>(dcfPulseWindow + dcfFilterTicks) * DCF77_TICK_US / 1000u;
+
+
+// decoded frame (local time of Germany)
+struct DcfTime_s
+{
+    uint8_t year;       // 0..99 (2000..2099)
+    uint8_t month;      // 1..12
+    uint8_t day;        // 1..31
+    uint8_t weekday;    // 1=monday..7=sunday
+    uint8_t hour;       // 0..23
+    uint8_t minute;     // 0..59
+    uint8_t utcOffset;  // hours, 1=CET, 2=CEST
+};
+
+
+// one bit of the frame
+inline bool dcfBit(const uint8_t* bits, uint8_t n)
+{
+    return (bits[n >> 3] >> (n & 7)) & 1;
+}
+
+
+// BCD number of len bits (weights 1,2,4,8,10,20,40,80), parity is xor-ed with every 1 bit
+// returns: value, 0xff=invalid units digit
+inline uint8_t dcfBcd(const uint8_t* bits, uint8_t first, uint8_t len, uint8_t& parity)
+{
+    uint8_t units = 0, tens = 0;
+    for (uint8_t i = 0; i < len; ++i) {
+        if (!dcfBit(bits, first + i))
+            continue;
+        parity ^= 1;
+        if (i < 4)
+            units |= 1 << i;
+        else
+            tens |= 1 << (i - 4);
+    }
+    return units > 9 ? 0xff : tens * 10 + units;
+}
+
+
+// decode the frame with parity and range checks
+// returns: 0=OK, -1=error
+inline int8_t dcfDecode(const uint8_t* bits, DcfTime_s& t)
+{
+    if (dcfBit(bits, 0) || !dcfBit(bits, 20))
+        return -1; //frame markers
+    bool cest = dcfBit(bits, 17);
+    if (cest == dcfBit(bits, 18))
+        return -1; //exactly one of CEST/CET
+
+    uint8_t p = 0;
+    t.minute = dcfBcd(bits, 21, 7, p);
+    if (p != dcfBit(bits, 28))
+        return -1;
+    p = 0;
+    t.hour = dcfBcd(bits, 29, 6, p);
+    if (p != dcfBit(bits, 35))
+        return -1;
+    p = 0;
+    t.day = dcfBcd(bits, 36, 6, p);
+    t.weekday = dcfBcd(bits, 42, 3, p);
+    t.month = dcfBcd(bits, 45, 5, p);
+    t.year = dcfBcd(bits, 50, 8, p);
+    if (p != dcfBit(bits, 58))
+        return -1;
+
+    if (t.minute > 59 || t.hour > 23 || t.day < 1 || t.day > 31 || t.weekday < 1 || t.weekday > 7
+            || t.month < 1 || t.month > 12 || t.year > 99)
+        return -1;
+    t.utcOffset = cest ? 2 : 1;
+    return 0;
+}
+
+
+// utc minutes since 2000-01-01
+// two frames are consecutive when these differ by 1
+inline uint32_t dcfUtcMinutes(const DcfTime_s& t)
+{
+    // days before the year (2000 is leap) and before the month
+    uint16_t days = t.year * 365u + (t.year + 3u) / 4u;
+    for (uint8_t m = 1; m < t.month; ++m)
+        days += m == 2 ? (t.year % 4 == 0 ? 29 : 28) : 30 + ((m + (m >> 3)) & 1);
+    days += t.day - 1;
+
+    return (static_cast<uint32_t>(days) * 24u + t.hour) * 60u + t.minute - t.utcOffset * 60u;
+}
+
+
+#endif // __DCF77_H__
@@ -19,6 +19,8 @@
 #include "config.h"
 #include "globals.h"
 #include "display.h"
+#include "profiler.h"
+#include "switch.h"
 
 
 // backlight timestamp
@@ -29,14 +31,16 @@ bool backlightOn = false;
 // flag for redrawing whole info on the display
 bool refreshScreen = true;
 
-// selector for currently displayed screen (0=default "home" screen)
-uint8_t screenSelector = 0;
-// (HEXADECIMAL) upper digit is the screen, lower digit is subscreen/certain value on the screen
+// selector for currently displayed screen, index into screens[] (0=default "home" screen)
+// screen id is (HEXADECIMAL): upper digit is the screen, lower digit is subscreen/certain value on the screen
 // 1x = (default) date/time, sun altitude, switch dedlay, switch times
 // 2x = gps info
 // 3x = diagnostics
 // 4x = version info
-uint8_t screenSequence[] = {0x11, 0x12, 0x20, 0x30, 0x40};
+uint8_t screenSelector = 0;
+
+// switch channel shown (and set by buttons) on the 1x screens
+uint8_t displayChannel = 0;
 
 
 
@@ -54,36 +58,24 @@ void fillUpToN(char * buf, uint8_t n)
 }
 
 
-// cycle between screens or values
-void nextScreen()
-{
-    // advance to the next screen
-    screenSelector = (screenSelector + 1) % (sizeof(screenSequence) / sizeof(uint8_t));
-    refreshScreen = true;
-}
-
-// get currently displayed screen/value
-uint8_t getActiveScreen()
-{
-    return screenSequence[screenSelector];
-}
-
-
 // print a message about close upcomming switch-state change
 // return: true=msg was printed, false=nothing done
 bool switchExpectedSoon(const DateTime& nowUtc)
 {
     int8_t isComming = 0; //0=none, 1=ON, 2=OFF
-    long diff = timeToSwitchOn(nowUtc);
-    if (diff >= 0 && diff <= 300) {
-        // switch ON is comming
-        isComming = 1;
-    }
-    else {
-        diff = timeToSwitchOff(nowUtc);
+    long diff;
+    for (uint8_t ch = 0; ch < SWITCH_CHANNELS && !isComming; ++ch) {
+        diff = timeToSwitchOn(nowUtc, ch);
         if (diff >= 0 && diff <= 300) {
-            // switch OFF is comming
-            isComming = 2;
+            // switch ON is comming
+            isComming = 1;
+        }
+        else {
+            diff = timeToSwitchOff(nowUtc, ch);
+            if (diff >= 0 && diff <= 300) {
+                // switch OFF is comming
+                isComming = 2;
+            }
         }
     }
 
@@ -92,12 +84,11 @@ bool switchExpectedSoon(const DateTime& nowUtc)
         buf[0] = '\0';
         fillUpToN(buf, 20);
 
-        printString(buf, isComming == 1 ? "ZAPNUTI ZA" : "VYPNUTI ZA", 0, false);
-        //printString(buf + 3, "PNUTI ZA", 0, false);
+        printString_P(buf, isComming == 1 ? PSTR("ZAPNUTI ZA") : PSTR("VYPNUTI ZA"), 0, false);
         printInt(buf + 12, diff, false, 4, false);
-        printString(buf + 17, "sec", 0, false);
+        printString_P(buf + 17, PSTR("sec"), 0, false);
 
-        lcd.println(buf);
+        lcdPrintLine(buf);
 
         backlightTS = millis(); //light up display
         return true; //comming soon msg printed
@@ -106,229 +97,543 @@ bool switchExpectedSoon(const DateTime& nowUtc)
 }
 
 
-// draw screen on lcd display:
-// 1 = screen1: date/time, sun altitude, switch times
-void switchTimeScreen(const DateTime& nowUtc, uint8_t subScreen)
-{
-    // začátek obrazovky
-    //lcd.setCursor(0, 0);
-    lcd.home();
-
-    // ========= LINE 1 - local date/time
-    DateTime nowLocal = localDateTime(nowUtc);
-    char buf[32];
-
-    if (!switchExpectedSoon(nowUtc)) {
-        // switch is not comming, normal msg
-        buf[0] = '\0';
-        fillUpToN(buf, 20);
+/**** SCREEN LAYOUTS ****/
 
-        printDate(buf, nowLocal, 3, false);
-        printTime(buf + 12, nowLocal, 3, false);
+// type of the field, says how to print the value of the source
+enum FieldType : uint8_t
+{
+    FT_END = 0,     // end of the line
+    FT_TEXT,        // constant text, source=index into screenTexts[]
+    FT_INT,         // integer number, right aligned to width
+    FT_PERCENT,     // integer number followed by '%', left aligned
+    FT_FIXED1S,     // fixed-point with 1 decimal place and forced sign, right aligned to width
+    FT_FIXED4,      // fixed-point with 4 decimal places, right aligned to width
+    FT_DATE,        // dd.mm.yyyy
+    FT_TIME_HM,     // hh:mm
+    FT_TIME_HMS,    // hh:mm:ss
+    FT_DELAY,       // secs printed as sec/min/hod/dni, right aligned to width. negative="--"
+    FT_STATUS,      // 0="OK", other="FAIL", right aligned to width
+    FT_PROF,        // profiler avg/max time in msec, source=ProfSlot, right aligned to width
+};
+
+// source of the value
+enum FieldSource : uint8_t
+{
+    SRC_NOW_LOCAL = 0,  // local date/time
+    SRC_SUNSET,         // sunset today localtime
+    SRC_SUNRISE,        // sunrise next day localtime
+    SRC_SWITCH_ON,      // switch-ON localtime (of displayChannel)
+    SRC_SWITCH_OFF,     // switch-OFF localtime (of displayChannel)
+    SRC_SUN_ALT,        // configured sun altitude (degs) (of displayChannel)
+    SRC_SWITCH_DELAY,   // configured switch delay (secs) (of displayChannel)
+    SRC_CHANNEL,        // number of displayChannel (1..)
+    SRC_GPS_PCT,        // gps signal quality (%)
+    SRC_GPS_SATS,       // number of satellites
+    SRC_GPS_LAT,        // current gps latitude
+    SRC_GPS_LNG,        // current gps longitude
+    SRC_CFG_LAT,        // stored latitude
+    SRC_CFG_LNG,        // stored longitude
+    SRC_RTC_SYNC_AGE,   // secs since last rtc setting, -1=never
+    SRC_TEST_GPS,       // result of testGps()
+    SRC_TEST_RTC,       // result of testRtc()
+    SRC_TEST_EEPROM,    // result of testEeprom()
+    SRC_UPTIME,         // uptime (secs)
+    SRC_STACK_USED,     // deepest stack use since boot (bytes)
+    SRC_STACK_FREE,     // ram never touched by the stack (bytes)
+    SRC_RAM_STATIC,     // size of the globals (bytes)
+    SRC_GPS_TTFF,       // time to the first fix of this start (secs), -1=no fix yet
+    SRC_TTFF_COLD,      // ttff of the last start without aiding (secs), -1=unknown
+    SRC_TTFF_AIDED,     // ttff of the last start with position/time
+    SRC_TTFF_RESTORED,  // ttff of the last start with the ephemeris/almanac backup
+};
+
+// one field of the screen line, stored in flash
+struct ScreenField_s
+{
+    uint8_t type;   // FieldType
+    uint8_t col;    // column where the field starts
+    uint8_t width;  // reserved width for right aligned values
+    uint8_t source; // FieldSource, or text index for FT_TEXT
+};
+
+// one screen, stored in flash
+struct Screen_s
+{
+    uint8_t id;         // (HEXADECIMAL) upper digit is the screen, lower digit is subscreen
+    uint8_t liveLines;  // number of lines redrawn every time, rest only when refreshScreen is set
+    const ScreenField_s * lines[4];
+};
+
+
+// texts of the screens
+const char txtSlunce[] PROGMEM = "slunce";
+const char txtStupne[] PROGMEM = "stupne";
+const char txtZpozdeni[] PROGMEM = "zpozdeni";
+const char txtSec[] PROGMEM = "sec";
+const char txtZapad[] PROGMEM = "zapad";
+const char txtSviceni[] PROGMEM = "sviceni";
+const char txtDash[] PROGMEM = "-";
+const char txtGps[] PROGMEM = "GPS";
+const char txtSatelitu[] PROGMEM = "satelitu";
+const char txtAkt[] PROGMEM = "akt:";
+const char txtPam[] PROGMEM = "pam:";
+const char txtComma[] PROGMEM = ",";
+const char txtSerizeni[] PROGMEM = "serizeni pred";
+const char txtGpsTest[] PROGMEM = "GPS pozice/cas";
+const char txtRtcTest[] PROGMEM = "RTC hodinky";
+const char txtEepromTest[] PROGMEM = "EEPROM config";
+const char txtUptime[] PROGMEM = "doba behu";
+#if STACK_PAINT
+const char txtZasobnik[] PROGMEM = "zasobnik max";
+const char txtVolno[] PROGMEM = "volno min";
+const char txtGlobalni[] PROGMEM = "globalni";
+const char txtBajtu[] PROGMEM = "B";
+#endif
+#if GPS_BACKUP
+const char txtTtff[] PROGMEM = "TTFF ted";
+const char txtTtffCold[] PROGMEM = "bez pomoci";
+const char txtTtffAided[] PROGMEM = "pozice+cas";
+const char txtTtffRestored[] PROGMEM = "ze zalohy";
+#endif
+#if PROFILER
+const char txtProf[] PROGMEM = "cas behu   prum/max";
+const char txtProfDisplay[] PROGMEM = "display";
+const char txtProfCalc[] PROGMEM = "vypocet";
+const char txtProfGps[] PROGMEM = "gps sync";
+#endif
+const char txtBuild[] PROGMEM = "build: " __DATE__;
+const char txtEmail[] PROGMEM = "solamyl@seznam.cz";
+const char txtGithub[] PROGMEM = "github.com/solamyl/";
 
-        lcd.println(buf);
-    }
-    // když není potřeba refreshovat vše, ukonči
-    if (!refreshScreen)
-        return;
+// index into screenTexts[] (must match its order)
+enum TextId : uint8_t
+{
+    TX_SLUNCE = 0, TX_STUPNE, TX_ZPOZDENI, TX_SEC, TX_ZAPAD, TX_SVICENI, TX_DASH,
+    TX_GPS, TX_SATELITU, TX_AKT, TX_PAM, TX_COMMA, TX_SERIZENI,
+    TX_GPS_TEST, TX_RTC_TEST, TX_EEPROM_TEST, TX_UPTIME,
+#if STACK_PAINT
+    TX_ZASOBNIK, TX_VOLNO, TX_GLOBALNI, TX_BAJTU,
+#endif
+#if GPS_BACKUP
+    TX_TTFF, TX_TTFF_COLD, TX_TTFF_AIDED, TX_TTFF_RESTORED,
+#endif
+#if PROFILER
+    TX_PROF, TX_PROF_DISPLAY, TX_PROF_CALC, TX_PROF_GPS,
+#endif
+    TX_VERSION, TX_BUILD, TX_EMAIL, TX_GITHUB,
+};
+
+const char * const screenTexts[] PROGMEM = {
+    txtSlunce, txtStupne, txtZpozdeni, txtSec, txtZapad, txtSviceni, txtDash,
+    txtGps, txtSatelitu, txtAkt, txtPam, txtComma, txtSerizeni,
+    txtGpsTest, txtRtcTest, txtEepromTest, txtUptime,
+#if STACK_PAINT
+    txtZasobnik, txtVolno, txtGlobalni, txtBajtu,
+#endif
+#if GPS_BACKUP
+    txtTtff, txtTtffCold, txtTtffAided, txtTtffRestored,
+#endif
+#if PROFILER
+    txtProf, txtProfDisplay, txtProfCalc, txtProfGps,
+#endif
+    appVersion, txtBuild, txtEmail, txtGithub,
+};
+
+
+// 1x = date/time, sun altitude or switch delay, switch times
+const ScreenField_s lineDateTime[] PROGMEM = {
+    {FT_DATE, 0, 0, SRC_NOW_LOCAL},
+    {FT_TIME_HMS, 12, 0, SRC_NOW_LOCAL},
+    {FT_END}
+};
+const ScreenField_s lineSunAltitude[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_SLUNCE},
+#if SWITCH_CHANNELS > 1
+    {FT_INT, 6, 1, SRC_CHANNEL},
+#endif
+    {FT_FIXED1S, 7, 6, SRC_SUN_ALT},
+    {FT_TEXT, 14, 0, TX_STUPNE},
+    {FT_END}
+};
+const ScreenField_s lineSwitchDelay[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_ZPOZDENI},
+#if SWITCH_CHANNELS > 1
+    {FT_INT, 8, 1, SRC_CHANNEL},
+#endif
+    {FT_INT, 9, 7, SRC_SWITCH_DELAY},
+    {FT_TEXT, 17, 0, TX_SEC},
+    {FT_END}
+};
+const ScreenField_s lineSunset[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_ZAPAD},
+    {FT_TIME_HM, 9, 0, SRC_SUNSET},
+    {FT_TEXT, 14, 0, TX_DASH},
+    {FT_TIME_HM, 15, 0, SRC_SUNRISE},
+    {FT_END}
+};
+const ScreenField_s lineSwitchTimes[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_SVICENI},
+#if SWITCH_CHANNELS > 1
+    {FT_INT, 7, 1, SRC_CHANNEL},
+#endif
+    {FT_TIME_HM, 9, 0, SRC_SWITCH_ON},
+    {FT_TEXT, 14, 0, TX_DASH},
+    {FT_TIME_HM, 15, 0, SRC_SWITCH_OFF},
+    {FT_END}
+};
 
-    // ========= LINE 2 - vyska slunce / zpoždění spínače
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
+// 2x = gps info
+const ScreenField_s lineGpsSignal[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_GPS},
+    {FT_PERCENT, 4, 0, SRC_GPS_PCT},
+    {FT_INT, 9, 2, SRC_GPS_SATS},
+    {FT_TEXT, 12, 0, TX_SATELITU},
+    {FT_END}
+};
+const ScreenField_s lineGpsPosition[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_AKT},
+    {FT_FIXED4, 5, 7, SRC_GPS_LAT},
+    {FT_TEXT, 12, 0, TX_COMMA},
+    {FT_FIXED4, 13, 7, SRC_GPS_LNG},
+    {FT_END}
+};
+const ScreenField_s lineCfgPosition[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_PAM},
+    {FT_FIXED4, 5, 7, SRC_CFG_LAT},
+    {FT_TEXT, 12, 0, TX_COMMA},
+    {FT_FIXED4, 13, 7, SRC_CFG_LNG},
+    {FT_END}
+};
+const ScreenField_s lineRtcSync[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_SERIZENI},
+    {FT_DELAY, 14, 6, SRC_RTC_SYNC_AGE},
+    {FT_END}
+};
 
-    if (subScreen == 1) {
-        printString(buf, "slunce", 0, false);
-        printFloat(buf + 7, config.switchSunAltitude_x10 / 10.0, 1, true, 6, false);
-        printString(buf + 14, "stupne", 0, false);
-        //printFloat(buf + 9, config.switchSunAltitude_x10 / 10.0, 1, true, 7, false);
-        //printString(buf + 17, "st.", 0, false);
-    }
-    else if (subScreen == 2) {
-        printString(buf, "zpozdeni", 0, false);
-        printInt(buf + 9, config.switchTimeDelay, false, 7, false);
-        printString(buf + 17, "sec", 0, false);
-    }
-    lcd.println(buf);
+// 3x = diagnostics
+const ScreenField_s lineTestGps[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_GPS_TEST},
+    {FT_STATUS, 16, 4, SRC_TEST_GPS},
+    {FT_END}
+};
+const ScreenField_s lineTestRtc[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_RTC_TEST},
+    {FT_STATUS, 16, 4, SRC_TEST_RTC},
+    {FT_END}
+};
+const ScreenField_s lineTestEeprom[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_EEPROM_TEST},
+    {FT_STATUS, 16, 4, SRC_TEST_EEPROM},
+    {FT_END}
+};
+const ScreenField_s lineUptime[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_UPTIME},
+    {FT_DELAY, 12, 8, SRC_UPTIME},
+    {FT_END}
+};
+
+#if STACK_PAINT
+// 32 = ram usage, the deepest stack since boot
+const ScreenField_s lineStackUsed[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_ZASOBNIK},
+    {FT_INT, 13, 5, SRC_STACK_USED},
+    {FT_TEXT, 19, 0, TX_BAJTU},
+    {FT_END}
+};
+const ScreenField_s lineStackFree[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_VOLNO},
+    {FT_INT, 13, 5, SRC_STACK_FREE},
+    {FT_TEXT, 19, 0, TX_BAJTU},
+    {FT_END}
+};
+const ScreenField_s lineRamStatic[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_GLOBALNI},
+    {FT_INT, 13, 5, SRC_RAM_STATIC},
+    {FT_TEXT, 19, 0, TX_BAJTU},
+    {FT_END}
+};
+#endif
 
-    // ========= LINE 3 - zapad
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
+#if GPS_BACKUP
+// 33 = time to the first fix, this start and the last start of each kind
+const ScreenField_s lineTtff[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_TTFF},
+    {FT_DELAY, 12, 8, SRC_GPS_TTFF},
+    {FT_END}
+};
+const ScreenField_s lineTtffCold[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_TTFF_COLD},
+    {FT_DELAY, 12, 8, SRC_TTFF_COLD},
+    {FT_END}
+};
+const ScreenField_s lineTtffAided[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_TTFF_AIDED},
+    {FT_DELAY, 12, 8, SRC_TTFF_AIDED},
+    {FT_END}
+};
+const ScreenField_s lineTtffRestored[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_TTFF_RESTORED},
+    {FT_DELAY, 12, 8, SRC_TTFF_RESTORED},
+    {FT_END}
+};
+#endif
 
-    printString(buf, "zapad", 0, false);
-    printTime(buf + 9, sunsetTimeLocal, 2, false);
-    buf[14] = '-';
-    printTime(buf + 15, sunriseTimeLocal, 2, false);
+#if PROFILER
+// 31 = profiler, avg/max run times
+const ScreenField_s lineProfHeader[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_PROF},
+    {FT_END}
+};
+const ScreenField_s lineProfDisplay[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_PROF_DISPLAY},
+    {FT_PROF, 8, 12, PROF_DISPLAY},
+    {FT_END}
+};
+const ScreenField_s lineProfCalc[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_PROF_CALC},
+    {FT_PROF, 8, 12, PROF_CALC},
+    {FT_END}
+};
+const ScreenField_s lineProfGpsSync[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_PROF_GPS},
+    {FT_PROF, 8, 12, PROF_GPS_SYNC},
+    {FT_END}
+};
+#endif
 
-    lcd.println(buf);
+// 4x = version info
+const ScreenField_s lineVersion[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_VERSION},
+    {FT_END}
+};
+const ScreenField_s lineBuild[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_BUILD},
+    {FT_END}
+};
+const ScreenField_s lineEmail[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_EMAIL},
+    {FT_END}
+};
+const ScreenField_s lineGithub[] PROGMEM = {
+    {FT_TEXT, 0, 0, TX_GITHUB},
+    {FT_END}
+};
+
+// sequence of the screens, cycled by nextScreen()
+const Screen_s screens[] PROGMEM = {
+    {0x11, 1, {lineDateTime, lineSunAltitude, lineSunset, lineSwitchTimes}},
+    {0x12, 1, {lineDateTime, lineSwitchDelay, lineSunset, lineSwitchTimes}},
+    {0x20, 2, {lineGpsSignal, lineGpsPosition, lineCfgPosition, lineRtcSync}},
+    {0x30, 1, {lineTestGps, lineTestRtc, lineTestEeprom, lineUptime}},
+#if PROFILER
+    {0x31, 4, {lineProfHeader, lineProfDisplay, lineProfCalc, lineProfGpsSync}},
+#endif
+#if STACK_PAINT
+    {0x32, 4, {lineStackUsed, lineStackFree, lineRamStatic, lineUptime}},
+#endif
+#if GPS_BACKUP
+    {0x33, 1, {lineTtff, lineTtffCold, lineTtffAided, lineTtffRestored}},
+#endif
+    {0x40, 1, {lineVersion, lineBuild, lineEmail, lineGithub}},
+};
+constexpr uint8_t screensCount = sizeof(screens) / sizeof(Screen_s);
 
-    // ========= LINE 4 - sviceni
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
-    
-    printString(buf, "sviceni", 0, false);
-    printTime(buf + 9, switchOnTimeLocal, 2, false);
-    buf[14] = '-';
-    printTime(buf + 15, switchOffTimeLocal, 2, false);
 
-    lcd.println(buf);
+// get date/time value of the field source
+DateTime fieldDateTime(uint8_t source, const DateTime& nowUtc)
+{
+    switch (source) {
+    case SRC_SUNSET: return sunsetTimeLocal;
+    case SRC_SUNRISE: return sunriseTimeLocal;
+    case SRC_SWITCH_ON:
+        return localDateTime(DateTime(displaySwitchUtc(displayChannel, true) + config.channel[displayChannel].timeDelay));
+    case SRC_SWITCH_OFF:
+        return localDateTime(DateTime(displaySwitchUtc(displayChannel, false) + config.channel[displayChannel].timeDelay));
+    default: return localDateTime(nowUtc);
+    }
 }
 
 
-// draw screen on lcd display:
-// 2 = screen2: gps info, switch delay
-void gpsInfoScreen(const DateTime& nowUtc, uint8_t subScreen)
+// get integer value of the field source
+long fieldInt(uint8_t source)
 {
-    // začátek obrazovky
-    lcd.home();
-
-    // ========= LINE 1 - GPS signal quality
-    char buf[32];
-    if (!switchExpectedSoon(nowUtc)) {
-        // switch is not comming, normal msg
-        buf[0] = '\0';
-        fillUpToN(buf, 20);
-
-        printString(buf, "GPS", 0, false);
-
+    switch (source) {
+    case SRC_SWITCH_DELAY:
+        return config.channel[displayChannel].timeDelay;
+    case SRC_CHANNEL:
+        return displayChannel + 1;
+    case SRC_GPS_PCT: {
         int pct = gps.hdop.hdop() > 0 ? (199 / gps.hdop.hdop() - 1) : 0;
-        if (pct > 100)
-            pct = 100;
-        int n = printInt(buf + 4, pct, false, 0, false);
-        buf[4 + n] = '%';
-
-        printInt(buf + 9, gps.satellites.value(), false, 2, false);
-        printString(buf + 12, "satelitu", 0, false);
-
-        lcd.println(buf);
+        return pct > 100 ? 100 : pct;
+    }
+    case SRC_GPS_SATS:
+        return gps.satellites.value();
+    case SRC_RTC_SYNC_AGE:
+        return datetimeSetTS > 0 ? static_cast<long>((millis() - datetimeSetTS) / 1000ul) : -1;
+    case SRC_TEST_GPS:
+        return testGps();
+    case SRC_TEST_RTC:
+        return testRtc();
+    case SRC_TEST_EEPROM:
+        return testEeprom();
+    case SRC_UPTIME:
+        return uptimeSecs;
+#if STACK_PAINT
+    case SRC_STACK_USED:
+        return stackMaxUsed();
+    case SRC_STACK_FREE:
+        return stackFree();
+    case SRC_RAM_STATIC:
+        return ramStatic();
+#endif
+#if GPS_BACKUP
+    case SRC_GPS_TTFF:
+        return gpsTtff > 0 ? static_cast<long>(gpsTtff) : -1;
+    case SRC_TTFF_COLD:
+    case SRC_TTFF_AIDED:
+    case SRC_TTFF_RESTORED: {
+        uint16_t secs = gpsTtffLast(source - SRC_TTFF_COLD);
+        return secs > 0 ? static_cast<long>(secs) : -1;
+    }
+#endif
+    default:
+        return 0;
     }
+}
 
-    // ========= LINE 2 - current position
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
 
-    printString(buf, "akt:", 0, false);
-    printFloat(buf + 5, gps.location.lat(), 4, false, 7, false);
-    buf[12] = ',';
-    printFloat(buf + 13, gps.location.lng(), 4, false, 7, false);
-    
-    fillUpToN(buf, 20); //for sure
-    lcd.println(buf);
+// gps coordinate in 1/10000 degs, straight from the parsed digits
+long rawToFixed4(const RawDegrees& raw)
+{
+    long v = raw.deg * 10000l + (raw.billionths + 50000ul) / 100000ul;
+    return raw.negative ? -v : v;
+}
 
-    // když není potřeba refreshovat vše, ukonči
-    if (!refreshScreen)
-        return;
 
-    // ========= LINE 3 - stored position
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
+// get fixed-point value of the field source (sun altitude in 1/10 degs, coordinates in 1/10000 degs)
+long fieldFixed(uint8_t source)
+{
+    switch (source) {
+    case SRC_SUN_ALT: return config.channel[displayChannel].sunAltitude_x10;
+    case SRC_GPS_LAT: return rawToFixed4(gps.location.rawLat());
+    case SRC_GPS_LNG: return rawToFixed4(gps.location.rawLng());
+    case SRC_CFG_LAT: return lround(config.latitude * 10000.0);
+    case SRC_CFG_LNG: return lround(config.longitude * 10000.0);
+    default: return 0;
+    }
+}
 
-    printString(buf, "pam:", 0, false);
-    printFloat(buf + 5, config.latitude, 4, false, 7, false);
-    buf[12] = ',';
-    printFloat(buf + 13, config.longitude, 4, false, 7, false);
-    
-    fillUpToN(buf, 20); //for sure
-    lcd.println(buf);
 
-    // ========= LINE 4 - rtc sync
+// render one line of the screen layout and send it to the display
+void renderLine(const ScreenField_s * line, const DateTime& nowUtc)
+{
+    char buf[32];
     buf[0] = '\0';
     fillUpToN(buf, 20);
 
-    printString(buf, "serizeni pred", 0, false);
-    if (datetimeSetTS > 0)
-        printDelay(buf + 14, (millis() - datetimeSetTS) / 1000ul, 6, false);
-    else
-        printString(buf + 18, "--", 0, false);
-    
+    ScreenField_s f;
+    for (memcpy_P(&f, line, sizeof(f)); f.type != FT_END; memcpy_P(&f, ++line, sizeof(f))) {
+        char * p = buf + f.col;
+
+        switch (f.type) {
+        case FT_TEXT:
+            printString_P(p, reinterpret_cast<const char *>(pgm_read_ptr(&screenTexts[f.source])), f.width, false);
+            break;
+        case FT_INT:
+            printInt(p, fieldInt(f.source), false, f.width, false);
+            break;
+        case FT_PERCENT:
+            p += printInt(p, fieldInt(f.source), false, f.width, false);
+            *p = '%';
+            break;
+        case FT_FIXED1S:
+            printFixed(p, fieldFixed(f.source), 1, true, f.width, false);
+            break;
+        case FT_FIXED4:
+            printFixed(p, fieldFixed(f.source), 4, false, f.width, false);
+            break;
+        case FT_DATE:
+            printDate(p, fieldDateTime(f.source, nowUtc), 3, false);
+            break;
+        case FT_TIME_HM:
+        case FT_TIME_HMS:
+            // times of the calc are not known before the first one (onUtc=0 would underflow)
+            if (f.source >= SRC_SUNSET && f.source <= SRC_SWITCH_OFF && switchTimesCalcTS == 0)
+                printString_P(p, f.type == FT_TIME_HMS ? PSTR("--:--:--") : PSTR("--:--"), 0, false);
+            else
+                printTime(p, fieldDateTime(f.source, nowUtc), f.type == FT_TIME_HMS ? 3 : 2, false);
+            break;
+        case FT_DELAY: {
+            long value = fieldInt(f.source);
+            if (value >= 0)
+                printDelay(p, value, f.width, false);
+            else
+                printString_P(p, PSTR("--"), f.width, false);
+            break;
+        }
+        case FT_STATUS:
+            printString_P(p, fieldInt(f.source) ? PSTR("FAIL") : PSTR("OK"), f.width, false);
+            break;
+#if PROFILER
+        case FT_PROF: {
+            const ProfStats_s& st = profStats[f.source];
+            char tmp[16];
+            int n = printInt(tmp, st.count ? st.sum / st.count / 1000ul : 0, false, 0, false);
+            tmp[n++] = '/';
+            n += printInt(tmp + n, st.max / 1000ul, false, 0, false);
+            tmp[n++] = 'm';
+            tmp[n++] = 's';
+            tmp[n] = '\0';
+            printString(p, tmp, f.width, false);
+            break;
+        }
+#endif
+        }
+    }
+
     fillUpToN(buf, 20); //for sure
-    lcd.println(buf);
+    lcdPrintLine(buf);
 }
 
 
-// draw screen on lcd display:
-// 3 = screen3: diagnostics
-void diagnosticScreen(const DateTime& nowUtc, uint8_t subScreen)
+// draw the selected screen on lcd display
+void renderScreen(uint8_t index, const DateTime& nowUtc)
 {
     // začátek obrazovky
-    lcd.home();
+    lcdHome();
 
-    char buf[32];
-    if (!switchExpectedSoon(nowUtc)) {
-        // switch is not comming, normal msg
-        buf[0] = '\0';
-        fillUpToN(buf, 20);
-        printString(buf, "GPS pozice/cas", 0, false);
-        printString(buf + 16, testGps() ? "FAIL" : "OK", 4, false);
-        lcd.println(buf);
-    }
-    // když není potřeba refreshovat vše, ukonči
-    if (!refreshScreen)
-        return;
+    // when switch is comming, its msg replaces the first line
+    uint8_t i = switchExpectedSoon(nowUtc) ? 1 : 0;
 
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
-    printString(buf, "RTC hodinky", 0, false);
-    printString(buf + 16, testRtc() ? "FAIL" : "OK", 4, false);
-    lcd.println(buf);
+    // když není potřeba refreshovat vše, vykresli jen živé řádky
+    uint8_t lines = refreshScreen ? 4 : pgm_read_byte(&screens[index].liveLines);
 
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
-    printString(buf, "EEPROM config", 0, false);
-    printString(buf + 16, testEeprom() ? "FAIL" : "OK", 4, false);
-    lcd.println(buf);
-
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
-    printString(buf, "doba behu", 0, false);
-    printDelay(buf + 12, uptimeSecs, 8, false);
-    fillUpToN(buf, 20); //for sure
-    lcd.println(buf);
+    for (; i < lines; ++i)
+        renderLine(reinterpret_cast<const ScreenField_s *>(pgm_read_ptr(&screens[index].lines[i])), nowUtc);
 }
 
 
-// draw screen on lcd display:
-// 4 = screen4: version info
-void versionInfoScreen(const DateTime& nowUtc, uint8_t subScreen)
+// cycle between screens or values
+// switch settings screens (0x11, 0x12 at the beginning of screens[]) are repeated for every channel
+void nextScreen()
 {
-    // začátek obrazovky
-    lcd.home();
-
-    char buf[32];
-    if (!switchExpectedSoon(nowUtc)) {
-        // switch is not comming, normal msg
-        buf[0] = '\0';
-        fillUpToN(buf, 20);
-        printString(buf, appVersion, 0, false);
-        fillUpToN(buf, 20); //for sure
-        lcd.println(buf);
+    refreshScreen = true;
+    if (getActiveScreen() == 0x12) {
+        if (++displayChannel < SWITCH_CHANNELS) {
+            screenSelector = 0;
+            return;
+        }
+        displayChannel = 0;
     }
-    // když není potřeba refreshovat vše, ukonči
-    if (!refreshScreen)
-        return;
 
-#if 1
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
-    printString(buf, "build: " __DATE__, 0, false);
-    lcd.println(buf);
-#else
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
-    printString(buf, "build", 0, false);
-    printString(buf + 9, __DATE__, 11, false);
-    fillUpToN(buf, 20); //for sure
-    lcd.println(buf);
-#endif
-
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
-    printString(buf, "solamyl@seznam.cz", 0, false);
-    lcd.println(buf);
+    // advance to the next screen
+    screenSelector = (screenSelector + 1) % screensCount;
+}
 
-    buf[0] = '\0';
-    fillUpToN(buf, 20);
-    printString(buf, "github.com/solamyl/", 0, false);
-    lcd.println(buf);
+// get currently displayed screen/value
+uint8_t getActiveScreen()
+{
+    return pgm_read_byte(&screens[screenSelector].id);
 }
 
 
@@ -340,18 +645,21 @@ void display(const DateTime& nowUtc)
     if (millis() - backlightTS < 60000ul/*60sec*/) {
         // should be ON
         if (!backlightOn) {
-            lcd.backlight();
+            lcdBacklight(true);
             backlightOn = true;
         }
     }
     else {
         // should be OFF
         if (backlightOn) {
-            lcd.noBacklight();
+            lcdBacklight(false);
             backlightOn = false;
             // switch back to default screen
             screenSelector = 0;
+            displayChannel = 0;
             refreshScreen = true;
+            // user has finished, save pending changes
+            configCommit(true);
         }
     }
 
@@ -359,18 +667,8 @@ void display(const DateTime& nowUtc)
     if (nowUtc.second() == 0)
         refreshScreen = true;
 
-    // switch on selected screen
-    uint8_t scr = (getActiveScreen() & 0xf0) >> 4;
-    uint8_t sub = (getActiveScreen() & 0x0f);
-
-    if (scr == 1) 
-        switchTimeScreen(nowUtc, sub);
-    else if (scr == 2)
-        gpsInfoScreen(nowUtc, sub);
-    else if (scr == 3)
-        diagnosticScreen(nowUtc, sub);
-    else
-        versionInfoScreen(nowUtc, sub);
+    // draw selected screen
+    renderScreen(screenSelector, nowUtc);
 
     // clear flag
     refreshScreen = false;
@@ -19,6 +19,16 @@
 #include "DateTime.h"
 
 
+// 1=lcd lines are sent by lcdfast.cpp in batched i2c transfers, 0=through LCDI2C_Generic
+#define LCD_BATCHED 1
+// 1=run i2c bus at 400kHz (DS3231, AT24C32 and PCF8574 all support it), 0=100kHz
+#define I2C_FAST_MODE 1
+// 1=print lcd speed comparison to Serial at startup (tools/sim_bench.cpp counts its bytes on the wire)
+#ifndef LCD_BENCHMARK
+#define LCD_BENCHMARK 0
+#endif
+
+
 // backlight timestamp
 // make backlight for some time since this timestamp
 extern unsigned long backlightTS;
@@ -26,6 +36,8 @@ extern unsigned long backlightTS;
 extern bool backlightOn;
 // flag for redrawing whole info on the display
 extern bool refreshScreen;
+// switch channel shown (and set by buttons) on the 1x screens
+extern uint8_t displayChannel;
 
 // cycle between screens or values
 void nextScreen();
@@ -36,4 +48,19 @@ uint8_t getActiveScreen();
 void display(const DateTime& nowUtc);
 
 
+// *** lcdfast.cpp ***
+// stats: number of bytes sent to the display on the i2c wire
+extern unsigned long lcdBytesOnWire;
+
+// next lcdPrintLine() prints on the first line
+void lcdHome();
+// print the string on the current line and advance to the next line
+// string is truncated or padded with spaces to the width of the display
+void lcdPrintLine(const char * str);
+// switch backlight on/off
+void lcdBacklight(bool on);
+// compare lcd.println() against lcdPrintLine(), results to Serial
+void lcdBenchmark();
+
+
 #endif // __DISPLAY_H__
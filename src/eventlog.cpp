@@ -0,0 +1,175 @@
+/*
+ * persistent event log in eeprom
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+
+#include <at24c32.h>
+
+#include "DateTime.h"
+#include "config.h"
+#include "globals.h"
+#include "log.h"
+
+
+// one record of the log (8 bytes), decoded by tools/eventlog_decode.py
+struct EventRecord_s
+{
+    uint32_t time;  // unixtime (utc) from rtc
+    uint8_t code;   // EventCode, bit 7 is the lap flag (flips with every pass over the ring)
+    uint8_t arg;    // small argument (eg. channel)
+    int16_t value;  // payload
+};
+static_assert(eepromPageSize % sizeof(EventRecord_s) == 0, "event records must not cross pages");
+
+constexpr uint16_t eventLogRecords = eventLogSize / sizeof(EventRecord_s);
+constexpr uint8_t recordsPerPage = eepromPageSize / sizeof(EventRecord_s);
+constexpr uint8_t eventLapFlag = 0x80;
+
+// write pending records after this time even if the page is not full (msec)
+constexpr unsigned long eventFlushPeriod = 60000ul;
+
+// index of the record to be written next
+uint16_t eventHead = 0;
+// lap flag of the records written in this pass
+uint8_t eventLap = 0;
+
+// records waiting for the page write, they all belong to one eeprom page
+EventRecord_s eventPending[recordsPerPage];
+uint8_t eventPendingCount = 0;
+// index of the first pending record
+uint16_t eventPendingFirst = 0;
+// timestamp of the first pending record (millis())
+unsigned long eventPendingTS = 0;
+
+// stats: records lost because the pending page could not be written
+uint16_t eventsDropped = 0;
+
+
+
+// address of the record in eeprom
+uint16_t eventAddr(uint16_t index)
+{
+    return eventLogAddr + index * sizeof(EventRecord_s);
+}
+
+
+// read lap flag of the record
+uint8_t eventLapOf(uint16_t index)
+{
+    return eeprom.read(eventAddr(index) + offsetof(EventRecord_s, code)) & eventLapFlag;
+}
+
+
+// find the place where to continue writing
+// records of the current pass have different lap flag than the rest from the previous pass,
+// so the head is found by binary search (~7 reads instead of 128)
+void eventLogInit()
+{
+    uint8_t first = eventLapOf(0);
+
+    uint16_t lo = 1, hi = eventLogRecords;
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+        if (eventLapOf(mid) == first)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < eventLogRecords) {
+        // pass has stopped in the middle of the ring
+        eventHead = lo;
+        eventLap = first;
+    }
+    else {
+        // whole ring is of the same lap (or erased eeprom), start next pass
+        eventHead = 0;
+        eventLap = first ^ eventLapFlag;
+    }
+}
+
+
+// write pending records into eeprom
+// force - write even if the page is not full and the flush period has not elapsed
+// records stay pending when the write fails, next try after the flush period (or forced)
+// returns: 0=OK or nothing to do, -1=error
+int eventLogFlush(bool force)
+{
+    if (eventPendingCount == 0)
+        return 0;
+    if (!force && eventPendingCount < recordsPerPage && millis() - eventPendingTS < eventFlushPeriod)
+        return 0;
+
+    if (eepromWrite(eventAddr(eventPendingFirst), reinterpret_cast<const uint8_t *>(eventPending),
+            eventPendingCount * sizeof(EventRecord_s)) < 0) {
+        eventPendingTS = millis();
+        LOG_E("eventlog: write failed");
+        return -1;
+    }
+    eventPendingCount = 0;
+    return 0;
+}
+
+
+// add record into the log
+// records are collected in RAM and written page by page
+// the record is dropped when the previous page is still not written
+void logEvent(uint8_t code, uint8_t arg, int16_t value)
+{
+    if (eventPendingCount == recordsPerPage && eventLogFlush(true) < 0) {
+        ++eventsDropped;
+        return;
+    }
+    if (eventPendingCount == 0) {
+        eventPendingTS = millis();
+        eventPendingFirst = eventHead;
+    }
+
+    EventRecord_s& rec = eventPending[eventPendingCount++];
+    rec.time = rtcCurrentTime().unixtime();
+    rec.code = (code & ~eventLapFlag) | eventLap;
+    rec.arg = arg;
+    rec.value = value;
+
+    ++eventHead;
+
+    // page is full
+    if (eventHead % recordsPerPage == 0) {
+        eventLogFlush(true);
+        if (eventHead >= eventLogRecords) {
+            // start next pass over the ring
+            eventHead = 0;
+            eventLap ^= eventLapFlag;
+        }
+    }
+}
+
+
+// print whole log to Serial as hex, from the oldest record to the newest
+void eventLogDump()
+{
+    eventLogFlush(true);
+
+    Serial.println(F("eventlog:"));
+    uint8_t rec[sizeof(EventRecord_s)];
+    for (uint16_t i = 0; i < eventLogRecords; ++i) {
+        eeprom.readBuffer(eventAddr((eventHead + i) % eventLogRecords), rec, sizeof(rec));
+        for (uint8_t j = 0; j < sizeof(rec); ++j) {
+            if (rec[j] < 0x10)
+                Serial.print('0');
+            Serial.print(rec[j], HEX);
+        }
+        Serial.println();
+    }
+    Serial.println(F("end"));
+    Serial.flush();
+}
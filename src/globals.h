@@ -15,23 +15,30 @@
 #define __GLOBALS_H__
 
 
+#include <SoftwareSerial.h>
 #include <TinyGPSPlus.h>
 #include <uRTCLib.h>
 #include <at24c32.h>
 #include <LCDI2C_Generic.h>
-#include <Mini_Button.h>
 
 #include "DateTime.h"
+#include "printnum.h"
 //#include "display.h"
 //#include "config.h"
 
 
 // *** SolarTimer.ino ***
-// version info string
-extern const char * appVersion;
+// version info string (in flash)
+extern const char appVersion[] PROGMEM;
 
 
 // *** main.cpp ***
+// 1=print number of loop() runs per second to Serial, and task stats once a minute
+#define LOOP_BENCHMARK 0
+
+// serial port to gps
+extern SoftwareSerial ss;
+
 // The TinyGPSPlus object
 extern TinyGPSPlus gps;
 
@@ -44,12 +51,6 @@ extern AT24C32 eeprom;
 // lcd display
 extern LCDI2C_Generic lcd;
 
-// buttons
-extern Button buttonSelect;
-extern AutoRepeatButton buttonPlus;
-extern AutoRepeatButton buttonMinus;
-extern LongPressDetector detectReset;
-
 // uptime counter (secs)
 extern unsigned long uptimeSecs;
 
@@ -63,19 +64,88 @@ void debugInfo();
 
 
 // *** buttons.cpp ***
-// method for handling buttons to be called often for being responsive
+// stats: the worst time from the button event to its handling (msec)
+extern uint16_t buttonLatencyMax;
+// stats: button events lost because the queue was full
+extern uint8_t buttonEventsLost;
+
+// set button pins and start sampling them from the timer interrupt
+void initButtons();
+// handle button events from the queue
 void handleButtons();
 
 
+// *** dcf77.cpp ***
+// 1=DCF77 receiver connected, second time source besides gps (costs flash, isr time and the pin)
+#define DCF77 0
+// pin with the receiver output
+#define DCF77_PIN 10
+// level of the output during the pulse (carrier reduced)
+#define DCF77_PULSE_LEVEL HIGH
+
+// stats: complete frames received
+extern uint16_t dcfFrames;
+// stats: frames rejected by parity or range checks
+extern uint16_t dcfErrors;
+
+// set the receiver pin
+void initDcf();
+// feed one sample to the decoder, called from the timer interrupt
+void dcfSample();
+// offer the time of the received frame to the arbiter (RTC)
+// returns: 0=rtc set, -1=no valid frame, +1=rtc not set
+int dcfSync(const DateTime& nowUtc);
+
+
+// *** eventlog.cpp ***
+// 1=print the event log to Serial at startup (opening the serial port resets the Nano)
+#define EVENTLOG_DUMP_AT_BOOT 1
+
+// codes of the logged events (max 0x7f), keep in sync with tools/eventlog_decode.py
+enum EventCode : uint8_t
+{
+    EV_BOOT = 1,            // device started
+    EV_SWITCH_ON = 2,       // switch turned ON, arg=channel, value=lateness after the event (secs)
+    EV_SWITCH_OFF = 3,      // switch turned OFF, arg=channel, value=lateness after the event (secs)
+    EV_RTC_SET = 4,         // rtc set, arg: 0=gps, 1=dcf77, value=difference (secs)
+    EV_RTC_LOST_POWER = 5,  // rtc lost power and was reset
+    EV_POSITION_SET = 6,    // position set from gps, value=hdop*10
+    EV_CONFIG_RESET = 7,    // config reset to defaults, arg: 0=invalid eeprom, 1=user reset
+    EV_GPS_FIX = 8,         // first gps fix since boot, arg=gpsAided, value=secs
+};
+
+// find the place where to continue writing
+void eventLogInit();
+// add record into the log
+// records are collected in RAM and written page by page
+// the record is dropped when the previous page is still not written
+void logEvent(uint8_t code, uint8_t arg=0, int16_t value=0);
+// write pending records into eeprom
+// force - write even if the page is not full and the flush period has not elapsed
+// returns: 0=OK or nothing to do, -1=error
+int eventLogFlush(bool force=false);
+// stats: records lost because the pending page could not be written
+extern uint16_t eventsDropped;
+// print whole log to Serial as hex, from the oldest record to the newest
+void eventLogDump();
+
+
 // *** gps.cpp ***
-extern unsigned long datetimeSetTS; // last time of setting clocks
+// 1=send the stored position and rtc time to the gps receiver at boot (u-blox UBX-AID-INI)
+// off by default: u-blox receivers only
+#ifndef GPS_AIDING
+#define GPS_AIDING 0
+#endif
 
 extern DateTime sunsetTimeLocal; // sunset today localtime
 extern DateTime sunriseTimeLocal; // sunrise next day localtime
-extern DateTime switchOnTimeUtc; // this day evening utc
-extern DateTime switchOnTimeLocal; // this day evening localtime
-extern DateTime switchOffTimeUtc; // next day morning utc
-extern DateTime switchOffTimeLocal; // next day morning localtime
+// last calc of the switch times (millis()), 0=not calculated yet
+extern unsigned long switchTimesCalcTS;
+// time to the first fix since boot (secs), 0=no fix yet or not measured (receiver kept its fix)
+extern uint16_t gpsTtff;
+// start of the receiver: 0=not aided, 1=got the stored position/time (UBX-AID-INI),
+// 2=also the ephemeris/almanac from the backup
+extern uint8_t gpsAided;
 
 // return RTC current time (UTC) using DateTime object
 DateTime rtcCurrentTime();
@@ -83,14 +153,33 @@ DateTime rtcCurrentTime();
 // input: utc
 // output: time adjusted to TZ and DST
 DateTime localDateTime(const DateTime& dt);
-
+// Hours as a float to the DateTime structure
+// fillup date as supplied or default 2000-01-01
+DateTime hoursToDateTime(double h, int year=2000, int8_t month=1, int8_t day=1);
+
+// send UBX message to the receiver
+void ubxSend(uint8_t cls, uint8_t id, const uint8_t * payload, uint16_t length);
+// receiver is powered up with the board, the time to the first fix is counted from now,
+// aiding is sent when the receiver starts talking
+// rtcValid - rtc time can be sent to the receiver
+void gpsStart(bool rtcValid);
 // GPS sync: time to RTC and position to config
 // returns: 0=OK, -1=err no gps signal, +1=sync not necessary, +2=not good conditions for resync
 int gpsSync(const DateTime& nowUtc);
+// forget that time and position were synced since restart, so the next gpsSync()
+// takes any data of sufficient quality
+void gpsForceSync();
 // calc all the dates
 // inputs: force - recalc even if it was recalculated shortly
 // returns: 0=OK, -1=err/problem, +1=not necessary
 int calculateSwitchTimes(const DateTime& nowUtc, bool force = false);
+// quick preview of the channel switch times from the last calc (sun altitude changed), display only
+// returns: 0=OK, -1=no calc done yet
+int previewSwitchTimes(uint8_t ch);
+// switch time of the channel to be displayed (the preview while the channel is edited)
+// inputs: on - true=switch-ON, false=switch-OFF
+// returns: unixtime utc, without delay
+uint32_t displaySwitchUtc(uint8_t ch, bool on);
 // test if GPS is responding
 // return: 0=OK, -1=error
 int testGps();
@@ -99,13 +188,108 @@ int testGps();
 int testRtc();
 
 
+// *** gpsbackup.cpp ***
+// 1=keep the receiver almanac/ephemeris in eeprom and send them back at boot (UBX-AID-ALM/EPH)
+// off by default: u-blox receivers only
+#ifndef GPS_BACKUP
+#define GPS_BACKUP 0
+#endif
+
+// stats: records changed in eeprom
+extern uint16_t gpsBackupWrites;
+// stats: records sent to the receiver at boot
+extern uint8_t gpsRestored;
+
+// feed the character from the receiver, AID-ALM/EPH messages are stored into eeprom
+void gpsBackupRx(uint8_t c);
+// start pushing the backup into the receiver (it lost the data with power)
+void gpsBackupRestore();
+// restore the backup in pieces, poll the receiver for the data when the fix is good for a while
+void gpsBackupSync(const DateTime& nowUtc);
+// store the ttff of this start (kind - gpsAided)
+void gpsTtffSave(uint8_t kind, uint16_t secs);
+// ttff of the last start of the kind (secs), 0=unknown
+uint16_t gpsTtffLast(uint8_t kind);
+
+
+// *** timesource.cpp ***
+// last time of setting (or confirming) clocks, 0=never
+extern unsigned long datetimeSetTS;
+
+// start the time arbiter with rtc of unknown age
+// rtcValid - false=rtc lost power or is not set, any source may set it
+void timeSourceInit(bool rtcValid);
+// the next valid time of the source (TimeSource) sets (or confirms) the rtc, even if the rtc
+// is trusted more or it was written shortly
+void timeSourceForce(uint8_t src);
+// time offered by the source (TimeSource), the arbiter decides whether it sets the rtc
+// inputs: score - confidence of the source (0..100), srcUtc - its time, nowUtc - rtc time
+// returns: 0=rtc set, +1=not set (confirmed or rtc is trusted more)
+int timeOffer(uint8_t src, uint8_t score, const DateTime& srcUtc, const DateTime& nowUtc);
+// print one line of the stats of the sources to Serial: 0,1=rtc, then one per source
+// (timeSourceStatLines in timesource.h)
+void printTimeSourceStats(uint8_t line);
+
+
+// *** shell.cpp ***
+// 1=command shell on the serial console (type "help")
+// off by default: check the flash/ram with tools/size_report.py before enabling
+#ifndef SHELL
+#define SHELL 0
+#endif
+
+// process characters received on the serial console, run the command when the line is complete
+// never waits for input
+void shellTask();
+
+
+// *** telemetry.cpp ***
+// 1=send binary status frame to Serial every second (see tools/telemetry_monitor.py)
+// the frame has the same layout with SHELL=0, the shell lateness is sent as 0
+// off by default: check the flash/ram with tools/size_report.py before enabling
+#ifndef TELEMETRY
+#define TELEMETRY 0
+#endif
+
+// number of frames not sent because the serial transmit buffer was full
+extern uint16_t telemetryDropped;
+
+// send status frame (COBS encoded, with crc16, delimited by 0x00)
+void sendTelemetry(const DateTime& nowUtc);
+
+
+// *** power.cpp ***
+// 1=sleep (idle mode) when no task is due, 0=spin
+#define IDLE_SLEEP 1
+
+// share of the time the cpu was running (not sleeping) in the last window (%)
+extern uint8_t activePercent;
+
+// switch off the peripherals nobody uses
+void powerInit();
+// sleep till the next interrupt, call when there is nothing to do
+void idle();
+// close the measurement window, compute activePercent
+void idleStatsUpdate();
+
+
+// *** stack.cpp ***
+// 1=paint the free ram at boot, so the deepest stack use can be measured
+#define STACK_PAINT 1
+
+// bytes of the stack used at most since boot (incl. interrupts)
+uint16_t stackMaxUsed();
+// bytes never touched between the globals (heap) and the deepest stack
+uint16_t stackFree();
+// size of the globals (.data + .bss + .noinit)
+uint16_t ramStatic();
+
+
 // *** print.cpp ***
-// print integer number into char buf[] - chatGPT recommended
-// buf - must be long enough to store the number
-// value - a number to print
-// reserve - how many places to reserve for right-aligning the number
-// returns: length of the output string stored in buf
-int printInt(char * buf, int value, bool forceSign=false, int8_t reserve=0, bool trailingZero=true);
+// 1=print cycles of the float and fixed-point formatting to Serial at startup
+#define PRINT_BENCHMARK 0
+
+// printInt() and printFixed() are in printnum.h
 
 // print float number into char buf[] - chatGPT recommended
 // buf - must be long enough to store the number
@@ -119,6 +303,10 @@ int printFloat(char * buf, float value, int8_t precision=1, bool forceSign=false
 // returns: length of the output string stored in buf
 int printString(char * buf, const char * value, int8_t reserve=0, bool trailingZero=true);
 
+// copy string stored in flash (PROGMEM) into char buf
+// returns: length of the output string stored in buf
+int printString_P(char * buf, const char * value, int8_t reserve=0, bool trailingZero=true);
+
 // print delay (secs) in form from secs to days
 // returns: length of the output string stored in buf
 int printDelay(char * buf, unsigned long value, int8_t reserve=0, bool trailingZero=true);
@@ -136,16 +324,22 @@ int printTime(char * buf, const DateTime& time, int8_t precision=3, bool trailin
 // print date and time in form of dd.mm.yyyy hh:mm:ss
 int printDateTime(char * buf, const DateTime& datetime, int8_t precision=3, bool trailingZero=true);
 
+// compare the float and fixed-point formatting, results to Serial
+void printBenchmark();
+
 
 // *** switch.cpp ***
-// initialize switch pin for output
+// (channel table is in switch.h)
+// initialize switch pins for output
 void initSwitch();
-// check switch status
+// check switch status of all the channels
 void checkSwitch(const DateTime& nowUtc);
+// inspect real state of the switch
+bool switchIsOn(uint8_t ch=0);
 // return number of seconds to the nearest switch-ON, negative value=already was switched
-long timeToSwitchOn(const DateTime& nowUtc);
+long timeToSwitchOn(const DateTime& nowUtc, uint8_t ch=0);
 // return number of seconds to the nearest switch-OFF, negative value=already was switched
-long timeToSwitchOff(const DateTime& nowUtc);
+long timeToSwitchOff(const DateTime& nowUtc, uint8_t ch=0);
 
 
 #endif // __GLOBALS_H__
@@ -21,19 +21,22 @@
 #include "config.h"
 #include "display.h"
 #include "globals.h"
+#include "log.h"
+#include "profiler.h"
+#include "switch.h"
+#include "timesource.h"
 
 
-unsigned long datetimeSetTS = 0; // last time of setting clocks
 unsigned long positionSetTS = 0; // last time of setting gps position
 
 unsigned long switchTimesCalcTS = 0; // switch times re-calculation timestamp
 
 DateTime sunsetTimeLocal; // sunset localtime
 DateTime sunriseTimeLocal; // sunrise localtime
-DateTime switchOnTimeUtc; // evening utc
-DateTime switchOnTimeLocal; // evening localtime
-DateTime switchOffTimeUtc; // morning utc
-DateTime switchOffTimeLocal; // morning localtime
+Ephemeris_s onDayEph, offDayEph; // ephemeris of the last calc, reused by previewSwitchTimes()
+// switch times of the edited channel, only displayed until the next calc (relays follow channels[])
+uint8_t previewChannel = SWITCH_CHANNELS; // SWITCH_CHANNELS=no preview
+Channel_s previewTimes;
 
 // european timezone CET (prague)
 const TimeSpan TZ_offset(0, +01/*hh*/, 00/*mm*/, 0);
@@ -48,6 +51,47 @@ unsigned long charsProcessed[2] = {0, 0};
 unsigned long failedChecksum[2] = {0, 0};
 unsigned long passedChecksum[2] = {0, 0};
 
+// time to the first fix since boot (secs), 0=no fix yet or not measured (receiver kept its fix)
+uint16_t gpsTtff = 0;
+// start of the receiver: 0=not aided, 1=got the stored position/time (UBX-AID-INI),
+// 2=also the ephemeris/almanac from the backup (gpsbackup.cpp)
+uint8_t gpsAided = 0;
+// millis() when the receiver was started (setup), 0=ttff not measured (it kept its fix)
+unsigned long gpsStartTS = 0;
+// waiting for the receiver to talk (aiding, ttff), time may be sent too
+bool gpsAidPending = false;
+bool gpsAidTime = false;
+
+// UBX-AID-INI payload (u-blox 6 protocol, little endian, no padding on avr)
+struct UbxAidIni_s
+{
+    int32_t lat;        // degs*1e7 (flag lla)
+    int32_t lon;        // degs*1e7
+    int32_t alt;        // cm, not known (flag altInv)
+    uint32_t posAcc;    // position accuracy (cm)
+    uint16_t tmCfg;     // time mark configuration, not used
+    uint16_t wn;        // gps week
+    uint32_t tow;       // time of the week (msec)
+    int32_t towNs;      // sub-msec part of tow
+    uint32_t tAccMs;    // time accuracy (msec)
+    uint32_t tAccNs;    // sub-msec part of tAccMs
+    int32_t clkD;       // clock drift, not known
+    uint32_t clkDAcc;
+    uint32_t flags;     // what is valid, UBX_INI_*
+};
+constexpr uint32_t UBX_INI_POS = 0x01;
+constexpr uint32_t UBX_INI_TIME = 0x02;
+constexpr uint32_t UBX_INI_LLA = 0x20;
+constexpr uint32_t UBX_INI_ALT_INV = 0x40;
+
+// stored position may be old or set by hand, the device may have been moved a bit (cm)
+constexpr uint32_t gpsAidPosAcc = 1000000ul; // 10km
+// rtc drifts ~0.2 sec/day, its last setting may be weeks ago (msec)
+constexpr uint32_t gpsAidTimeAcc = 2000ul;
+// gps time: 1980-01-06 as unixtime, ahead of utc by leap seconds (18 since 2017)
+constexpr uint32_t gpsEpochUnix = 315964800ul;
+constexpr uint8_t gpsLeapSecs = 18;
+
 
 
 // return RTC current time (UTC) using DateTime object
@@ -64,7 +108,7 @@ DateTime rtcCurrentTime()
 
 // Hours as a float to the DateTime structure
 // fillup date as supplied or default 2000-01-01
-DateTime hoursToDateTime(double h, int year=2000, int8_t month=1, int8_t day=1)
+DateTime hoursToDateTime(double h, int year, int8_t month, int8_t day)
 {
     if (isnan(h) /*|| isinf(h)*/) //handle exceptional values
         return DateTime();
@@ -217,20 +261,81 @@ bool isDST_EU(const DateTime& dt)
 // output: time adjusted to TZ and DST
 DateTime localDateTime(const DateTime& dt)
 {
+    PROF_BEGIN(PROF_LOCALTIME);
     DateTime localtime = dt + TZ_offset;
     bool summerTime = isDST_EU(localtime);
     if (summerTime)
         localtime = localtime + DST_offset; // summer time is happening
+    PROF_END(PROF_LOCALTIME);
     return localtime;
 }
 
 
-// GPS sync: time to RTC and position to config
+// send UBX message to the receiver, checksum (8-bit Fletcher) is over class, id, length and payload
+void ubxSend(uint8_t cls, uint8_t id, const uint8_t * payload, uint16_t length)
+{
+    uint8_t head[4] = {cls, id, static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8)};
+    uint8_t a = 0, b = 0;
+    ss.write(0xb5);
+    ss.write(0x62);
+    for (uint8_t i = 0; i < sizeof(head); ++i) {
+        a += head[i];
+        b += a;
+        ss.write(head[i]);
+    }
+    for (uint16_t i = 0; i < length; ++i) {
+        a += payload[i];
+        b += a;
+        ss.write(payload[i]);
+    }
+    ss.write(a);
+    ss.write(b);
+}
+
+
+// tell the receiver where and when it is (UBX-AID-INI), so it does not search the whole sky
+// returns: 0=sent, +1=nothing known
+int gpsAid(const DateTime& nowUtc)
+{
+    UbxAidIni_s m;
+    memset(&m, 0, sizeof(m));
+    if (config.latitude != 0.0 || config.longitude != 0.0) {
+        m.lat = lround(config.latitude * 1e7);
+        m.lon = lround(config.longitude * 1e7);
+        m.posAcc = gpsAidPosAcc;
+        m.flags |= UBX_INI_POS | UBX_INI_LLA | UBX_INI_ALT_INV;
+    }
+    if (gpsAidTime) {
+        uint32_t t = nowUtc.unixtime() - gpsEpochUnix + gpsLeapSecs;
+        m.wn = t / 604800ul;
+        m.tow = t % 604800ul * 1000ul;
+        m.tAccMs = gpsAidTimeAcc;
+        m.flags |= UBX_INI_TIME;
+    }
+    if (m.flags == 0)
+        return +1;
+
+    ubxSend(0x0b, 0x01, reinterpret_cast<const uint8_t *>(&m), sizeof(m));
+    LOG_I("gps: aided, pos=%u time=%u", (m.flags & UBX_INI_POS) != 0, gpsAidTime);
+    return 0;
+}
+
+
+// receiver is powered up with the board, the time to the first fix is counted from now
+// rtcValid - rtc time can be sent to the receiver
+void gpsStart(bool rtcValid)
+{
+    gpsStartTS = millis();
+    gpsAidTime = rtcValid;
+    gpsAidPending = true;
+}
+
+
+// GPS sync: time to the arbiter (RTC) and position to config
 // returns: 0=OK, -1=err no gps signal, +1=sync not necessary, +2=not good conditions for resync
 int gpsSync(const DateTime& nowUtc)
 {
     unsigned long nowTS = millis();
-    unsigned int hoursSinceRtcResync = (nowTS - datetimeSetTS) / (3600ul * 1000ul);
 
     // update stats of processed data
     int8_t sp = (nowTS / 10000ul) % 2;
@@ -263,8 +368,34 @@ int gpsSync(const DateTime& nowUtc)
         statsPeriod = sp;
     }
 
+    // aid the receiver as soon as it talks (it ignores input while booting),
+    // not needed when it kept its fix (only the board was reset), then there is no ttff either
+    if (gpsAidPending && gps.passedChecksum() > 0) {
+        gpsAidPending = false;
+        if (gps.location.isValid()) {
+            gpsStartTS = 0;
+        }
+        else {
+#if GPS_AIDING
+            gpsAided = gpsAid(nowUtc) == 0;
+#endif
+#if GPS_BACKUP
+            gpsBackupRestore();
+#endif
+        }
+    }
+
+    // time to the first fix, logged to compare the starts with and without aiding
+    if (gpsTtff == 0 && gpsStartTS != 0 && gps.location.isValid()) {
+        gpsTtff = (nowTS - gpsStartTS + 999ul) / 1000ul;
+        LOG_I("gps: first fix after %u s, aided %u", gpsTtff, gpsAided);
+        logEvent(EV_GPS_FIX, gpsAided, gpsTtff);
+#if GPS_BACKUP
+        gpsTtffSave(gpsAided, gpsTtff);
+#endif
+    }
+
     float hdop = -1.0; //invalid value
-    int8_t setTime = 0; //0=false, 1=set if necessary, 2=force
     bool setPosition = false;
 
     // check for gps input validity
@@ -275,44 +406,23 @@ int gpsSync(const DateTime& nowUtc)
             ; //useless value
         }
         else if (hdop < 0.1 || sats < 3 || sats > 30) {
-            Serial.print("resync: suspicious GPS data: hdop=");
-            //Serial.print(hdop);
-            Serial.print(static_cast<int>(hdop * 10.0));
-            Serial.print(", sats=");
-            Serial.println(sats);
+            LOG_W("resync: suspicious GPS data: hdop=%d, sats=%d", static_cast<int>(hdop * 10.0), sats);
             hdop = -1.0; // reset hdop to invalid value
         }
     }
 
-    // decide what to do on signal quality
+    // decide about the position on signal quality
     if (hdop > 0.0) {
         if (hdop < config.hdop) { //best quality ever
-            // we have reached best quality ever, set GPS and RTC
-            setTime = 2; //force
             setPosition = true;
         }
         else if (hdop < 4.0) { //sufficient quality
-
-            if (hdop < 2.0/*great*/ && hoursSinceRtcResync >= 1/*short time since RTC resync*/) {
-                // great quality, set RTC
-                setTime = 2; //force
-            }
-            else if (datetimeSetTS == 0/*rtc was not set since restart*/
-                    || hoursSinceRtcResync >= 168/*long time since RTC resync*/) {
-                // still ok quality, set RTC
-                setTime = 1; //if necessary
-            }
             if (positionSetTS == 0/*position was not set since restart*/) {
                 // sufficient value for replacing stored value
                 setPosition = true;
             }
         }
         else if (hdop < 50.0) { //quality is not good
-
-            if (nowUtc.year() == 2000/*probably RTC not set*/) {
-                // poor, but we may have someting. set RTC
-                setTime = 1; //if necessary
-            }
             if (config.hdop < 0.0/*position not set*/) {
                 // poor, but we may have something. set position
                 setPosition = true;
@@ -320,80 +430,33 @@ int gpsSync(const DateTime& nowUtc)
         }
     }
 
-    // if wanna set, but not valid or too old (1000 msec)
-    if (setTime && (!gps.date.isValid() || !gps.time.isValid() || gps.date.age() > 1000 || gps.time.age() > 1000)) {
-        Serial.println("resync: GPS time not valid");
-        setTime = 0; //false
+    // offer the time to the arbiter, if valid and fresh (1000 msec)
+    // it decides by hdop against the rtc confidence whether to set the rtc
+    if (hdop > 0.0) {
+        if (!gps.date.isValid() || !gps.time.isValid() || gps.date.age() > 1000 || gps.time.age() > 1000) {
+            LOG_D("resync: GPS time not valid");
+        }
+        else {
+            DateTime gpsNow = DateTime(gps.date.year(), gps.date.month(), gps.date.day(),
+                    gps.time.hour(), gps.time.minute(), gps.time.second());
+            timeOffer(TS_GPS, timeGpsScore(hdop), gpsNow, nowUtc);
+        }
     }
+
     if (setPosition && (!gps.location.isValid() || gps.location.age() > 1000)) {
-        Serial.println("resync: GPS pos not valid");
+        LOG_D("resync: GPS pos not valid");
         setPosition = false;
     }
 
-    /*Serial.print("resync: nowTS=");
-    Serial.print(nowTS);
-    Serial.print(", rtcTS=");
-    Serial.print(datetimeSetTS);
-    Serial.print(", posTS=");
-    Serial.print(positionSetTS);
-    Serial.print(", hrsSince=");
-    Serial.print(hoursSinceRtcResync);
-    Serial.print(", rtcYear=");
-    Serial.print(nowUtc.year());
-    Serial.print(", hdop=");
-    Serial.println(hdop);
-    Serial.print(":  setTime=");
-    Serial.print(setTime);
-    Serial.print(", setPos=");
-    Serial.println(setPosition);*/
-
-    // set new (updated) time in RTC module
-    if (setTime) {
-        // construct gps time
-        DateTime gpsNow = DateTime(gps.date.year(), gps.date.month(), gps.date.day(),
-                gps.time.hour(), gps.time.minute(), gps.time.second());
-
-        // nowUtc is from RTC
-        long timediff = (gpsNow - nowUtc).totalseconds();
-        Serial.print("resync: RTC diff ");
-        Serial.print(timediff);
-        Serial.print(" sec");
-
-        // set if necessary
-        if (setTime == 1) {
-            if (abs(timediff) < 3/*secs*/) {
-                // insignificant difference
-                setTime = 0; //don't set
-                datetimeSetTS = nowTS; //set flag, like it was set
-                Serial.print(" - not modified");
-            }
-        }
-        Serial.println();
-
-        // we need to set it
-        if (setTime) {
-            rtc.set(gpsNow.second(), gpsNow.minute(), gpsNow.hour(), gpsNow.dayOfTheWeek(),
-                    gpsNow.day(), gpsNow.month(), gpsNow.year() - 2000);
-            rtc.lostPowerClear(); //for sure
-            rtc.refresh();
-
-            datetimeSetTS = nowTS; //set flag
-        }
-    }
-
     // store (update) GPS position in config struct
     if (setPosition) {
-        Serial.print("resync: GPS hdop ");
-        //Serial.print(config.hdop);
-        Serial.print(static_cast<int>(config.hdop * 10.0));
-        Serial.print("=>");
-        //Serial.print(hdop);
-        Serial.print(static_cast<int>(hdop * 10.0));
-        Serial.println();
+        LOG_I("resync: GPS hdop %d=>%d", static_cast<int>(config.hdop * 10.0), static_cast<int>(hdop * 10.0));
 
         config.latitude = gps.location.lat();
         config.longitude = gps.location.lng();
         config.hdop = hdop;
+        configChanged();
+        logEvent(EV_POSITION_SET, 0, static_cast<int16_t>(hdop * 10.0));
 
         positionSetTS = nowTS; //set flag
     }
@@ -402,171 +465,117 @@ int gpsSync(const DateTime& nowUtc)
 }
 
 
+// forget that time and position were synced since restart, so the next gpsSync()
+// takes any data of sufficient quality
+void gpsForceSync()
+{
+    timeSourceForce(TS_GPS);
+    positionSetTS = 0;
+}
+
+
+// calc ephemeris of the day (utc) at the position from config
+// sunrise/sunset at the standard altitude come from the solar calculator, the declination
+// at those moments is enough to get the time of any other altitude by one acos() (see sunCrossing())
+void calcEphemeris(const DateTime& day, Ephemeris_s& eph)
+{
+    eph.midnight = DateTime(day.year(), day.month(), day.day()).unixtime();
+
+    // Calculate the times of sunrise => transit => sunset, in hours (UTC) for a given date
+    // "transit" is the time of the highest altitude of the sun (alias "solar noon")
+    calcSunriseSunset(day.year(), day.month(), day.day(),
+            config.latitude, config.longitude,
+            eph.transit, eph.sunrise, eph.sunset, SUNRISESET_STD_ALTITUDE);
+
+    // declination at sunrise and sunset (6 hours from noon in polar areas)
+    double ra, r;
+    DateTime t = hoursToDateTime(isnan(eph.sunrise) ? eph.transit - 6.0 : eph.sunrise, day.year(), day.month(), day.day());
+    calcEquatorialCoordinates(t.year(), t.month(), t.day(), t.hour(), t.minute(), t.second(), ra, eph.decRise, r);
+    t = hoursToDateTime(isnan(eph.sunset) ? eph.transit + 6.0 : eph.sunset, day.year(), day.month(), day.day());
+    calcEquatorialCoordinates(t.year(), t.month(), t.day(), t.hour(), t.minute(), t.second(), ra, eph.decSet, r);
+}
+
+
+// time when the sun crosses the altitude (unixtime utc)
+// evening - true=descending in the evening, false=ascending in the morning
+// when the sun does not cross the altitude at all (polar areas), noon is returned for
+// the sun all day below it and midnight for the sun all day above it. so the lights
+// are ON for the whole polar night and never during the polar day
+uint32_t sunCrossing(const Ephemeris_s& eph, double altitude, bool evening)
+{
+    double lat = radians(config.latitude);
+    double dec = radians(evening ? eph.decSet : eph.decRise);
+
+    // hour angle of the sun at the altitude
+    double c = (sin(radians(altitude)) - sin(lat) * sin(dec)) / (cos(lat) * cos(dec));
+    double h = c >= 1.0 ? 0.0 : c <= -1.0 ? 12.0 : degrees(acos(c)) / 15.0;
+
+    return eph.midnight + static_cast<long>((evening ? eph.transit + h : eph.transit - h) * 3600.0);
+}
+
+
 // calc all the dates
+// ephemeris is calculated once for the evening and once for the morning, then each
+// channel takes just one acos() per switch time
 // inputs: force - recalc even if it was recalculated shortly
 // returns: 0=OK, -1=err/problem, +1=not necessary
 int calculateSwitchTimes(const DateTime& nowUtc, bool force = false)
 {
-    // utc time
-    //DateTime nowUtc = rtcCurrentTime();
     unsigned long nowTS = millis();
     unsigned long secsSinceLastCalc = (nowTS - switchTimesCalcTS) / (1000ul);
 
     if (!force && nowUtc.year() > 2000 && switchTimesCalcTS > 0 && secsSinceLastCalc < 3600ul) {
         // times have been calculated recently
-        //Serial.println("calc: not necessary");
         return +1; //not necessary
     }
 
     if (nowUtc.year() == 2000/*rtc not set*/ || config.hdop < 0.0/*position not valid*/) {
-        Serial.println("calc: time+pos not valid");
+        LOG_D("calc: time+pos not valid");
         return -1; // input data not valid
     }
 
-    Serial.println("calc: switch times");
-
-    // calc solar noon (and eventually sunset or sunrise)
-    // "transit" is the time of the highest altitude of the sun (alias "solar noon")
-    // Calculate the times of sunrise => transit => sunset, in hours (UTC) for a given date
-    double transit, sunrise, sunset;
-    calcSunriseSunset(nowUtc.year(), nowUtc.month(), nowUtc.day(),
-            config.latitude, config.longitude,
-            transit, sunrise, sunset, SUNRISESET_STD_ALTITUDE);
-    DateTime solarNoon = hoursToDateTime(transit, nowUtc.year(), nowUtc.month(), nowUtc.day());
-
-    char buf[32];
-    /*Serial.print("solarNoon: "); //highest point of the sun
-    printDateTime(buf, solarNoon);
-    Serial.println(buf);*/
-
-    // calculate highest sun elevation (at solar noon)
-    // (now turned off, because app does not fit in arduino nano memory then)
-    /*double azimuth, elevation;
-    calcHorizontalCoordinates(solarNoon.year(), solarNoon.month(), solarNoon.day(),
-            solarNoon.hour(), solarNoon.minute(), solarNoon.second(),
-            config.latitude, config.longitude, azimuth, elevation);
-    Serial.print("azimuth: ");
-    printFloat(buf, azimuth);
-    Serial.println(buf);
-    Serial.print("elevation: ");
-    printFloat(buf, elevation);
-    Serial.println(buf);*/
+    LOG_I("calc: switch times");
 
     // if we are:
     // - before noon: sw-on=yesterday, sw-off=today
     // - after noon: sw-on=today, sw-off=tomorrow
-    DateTime swOnDay, swOffDay; //date when to switch on and off
-    if (nowUtc >= solarNoon) { //now is after noon - lights-ON period is starting today evening
-        swOnDay = solarNoon;
-        swOffDay = solarNoon + TimeSpan(86400l); //next day
-    }
-    else { //now is before noon - lights-ON period has started yesterday
-        swOnDay = solarNoon - TimeSpan(86400l); //previous day
-        swOffDay = solarNoon;
-    }
-    /*Serial.print("swOnDay: ");
-    printDateTime(buf, swOnDay);
-    Serial.println(buf);
-    Serial.print("swOffDay: ");
-    printDateTime(buf, swOffDay);
-    Serial.println(buf);*/
-
-    // solar calculator
-    // Calculate the times of sunrise, transit, and sunset, in hours (UTC)
-    double void1, void2;
-    if (swOnDay == solarNoon) {
-        // sunset already calculated, calculate also sunrise next day
-        calcSunriseSunset(swOffDay.year(), swOffDay.month(), swOffDay.day(),
-                config.latitude, config.longitude,
-                void1, sunrise, void2, SUNRISESET_STD_ALTITUDE);
-    }
-    else {
-        // sunrise already calculated, calculate also sunset previous day
-        calcSunriseSunset(swOnDay.year(), swOnDay.month(), swOnDay.day(),
-                config.latitude, config.longitude,
-                void1, void2, sunset, SUNRISESET_STD_ALTITUDE);
-    }
-    sunsetTimeLocal = localDateTime(hoursToDateTime(sunset, swOnDay.year(), swOnDay.month(), swOnDay.day()));
-    sunriseTimeLocal = localDateTime(hoursToDateTime(sunrise, swOffDay.year(), swOffDay.month(), swOffDay.day()));
-
-    // switch-ON time
-    // calc sunset, but with specified altitude
-    calcSunriseSunset(swOnDay.year(), swOnDay.month(), swOnDay.day(),
-            config.latitude, config.longitude,
-            transit, void1, sunset, SUNRISESET_STD_ALTITUDE + config.switchSunAltitude_x10 / 10.0);
-    
-    /*Serial.print("sunset hours: ");
-    printFloat(buf, sunset);
-    Serial.println(buf);*/
-
-    // if the given altitude is too high or too low - NaN is returned
-    // KNOWN BUG: following solution is not correct and will not work in polar areas (behind
-    // the polar circle) where the sun could be all day above or bellow the horizont.
-    // the proper solution is to obtain min/max sun altitude and evalueate it agains
-    // "sunAltitude" setting. but it is too expensive (limited program space) for this marginal case 
-    if (isnan(sunset)) {
-        // sunset is wrong, use some substitute
-        /*if (config.switchSunAltitude_x10 > 0)
-            // use solar noon as switch-ON time or all day ON
-            switchOnTimeUtc = hoursToDateTime(transit, swOnDay.year(), swOnDay.month(), swOnDay.day());
-        else
-            // use default day in the past for all day OFF
-            switchOnTimeUtc = DateTime();*/
-        switchOnTimeUtc = hoursToDateTime(config.switchSunAltitude_x10 > 0 ?
-                transit /*solar noon*/ : transit + 12.0 /*~next midnight*/,
-                swOnDay.year(), swOnDay.month(), swOnDay.day());
+    Ephemeris_s& onDay = onDayEph; //day when to switch on
+    Ephemeris_s& offDay = offDayEph; //day when to switch off
+    calcEphemeris(nowUtc, onDay);
+    if (nowUtc.unixtime() >= onDay.midnight + static_cast<long>(onDay.transit * 3600.0)) {
+        // now is after noon - lights-ON period is starting today evening
+        calcEphemeris(nowUtc + TimeSpan(86400l), offDay); //next day
     }
     else {
-        // correct sunset
-        switchOnTimeUtc = hoursToDateTime(sunset, swOnDay.year(), swOnDay.month(), swOnDay.day());
+        // now is before noon - lights-ON period has started yesterday
+        offDay = onDay;
+        calcEphemeris(nowUtc - TimeSpan(86400l), onDay); //previous day
     }
-    /*Serial.print("ON-utc:  ");
-    printDateTime(buf, switchOnTimeUtc);
-    Serial.println(buf);*/
-
-    switchOnTimeLocal = localDateTime(switchOnTimeUtc + TimeSpan(config.switchTimeDelay));
 
-    Serial.print("ON-loc:  ");
-    printDateTime(buf, switchOnTimeLocal);
-    Serial.println(buf);
+    DateTime d = DateTime(onDay.midnight);
+    sunsetTimeLocal = localDateTime(hoursToDateTime(onDay.sunset, d.year(), d.month(), d.day()));
+    d = DateTime(offDay.midnight);
+    sunriseTimeLocal = localDateTime(hoursToDateTime(offDay.sunrise, d.year(), d.month(), d.day()));
 
-    // switch-OFF time
-    // calc sunrise, but with specified altitude
-    calcSunriseSunset(swOffDay.year(), swOffDay.month(), swOffDay.day(),
-            config.latitude, config.longitude,
-            transit, sunrise, void1, SUNRISESET_STD_ALTITUDE + config.switchSunAltitude_x10 / 10.0);
-
-    /*Serial.print("sunrise hours: ");
-    printFloat(buf, sunrise);
-    Serial.println(buf);*/
-
-    // if the given altitude is too high or too low - NaN is returned
-    // KNOWN BUG: following solution is not correct. read comment above for sunset
-    if (isnan(sunrise)) {
-        // sunrise is wrong, use some substitute
-        /*if (config.switchSunAltitude_x10 > 0)
-            // use solar noon as switch-OFF time for all day ON
-            switchOffTimeUtc = hoursToDateTime(transit, swOffDay.year(), swOffDay.month(), swOffDay.day());
-        else
-            // use default day in the past for all day OFF
-            switchOffTimeUtc = DateTime();*/
-        switchOffTimeUtc = hoursToDateTime(config.switchSunAltitude_x10 > 0 ?
-                transit /*solar noon*/ : transit - 12.0 /*~previous midnight*/,
-                swOffDay.year(), swOffDay.month(), swOffDay.day());
-    }
-    else {
-        // correct sunrise
-        switchOffTimeUtc = hoursToDateTime(sunrise, swOffDay.year(), swOffDay.month(), swOffDay.day());
+    char buf[32];
+    for (uint8_t ch = 0; ch < SWITCH_CHANNELS; ++ch) {
+        double altitude = SUNRISESET_STD_ALTITUDE + config.channel[ch].sunAltitude_x10 / 10.0;
+        Channel_s& c = channels[ch];
+        c.onUtc = sunCrossing(onDay, altitude, true);
+        c.offUtc = sunCrossing(offDay, altitude, false);
+        if (c.offUtc < c.onUtc)
+            c.offUtc = c.onUtc; //polar day, lights stay OFF
+
+        long timeDelay = config.channel[ch].timeDelay;
+        printDateTime(buf, localDateTime(DateTime(c.onUtc + timeDelay)));
+        LOG_I("%u ON-loc:  %s", ch + 1, buf);
+        printDateTime(buf, localDateTime(DateTime(c.offUtc + timeDelay)));
+        LOG_I("%u OFF-loc: %s", ch + 1, buf);
     }
-    /*Serial.print("OFF-utc:  ");
-    printDateTime(buf, switchOffTimeUtc);
-    Serial.println(buf);*/
 
-    switchOffTimeLocal = localDateTime(switchOffTimeUtc + TimeSpan(config.switchTimeDelay));
-    
-    Serial.print("OFF-loc: ");
-    printDateTime(buf, switchOffTimeLocal);
-    Serial.println(buf);
+    // next switch event has to be found again
+    switchScheduleChanged();
+    previewChannel = SWITCH_CHANNELS;
 
     // values changed redraw screen
     refreshScreen = true;
@@ -577,6 +586,39 @@ int calculateSwitchTimes(const DateTime& nowUtc, bool force = false)
 }
 
 
+// quick update of the channel switch times after its sun altitude has changed
+// declination and transit are taken from the last calculateSwitchTimes(), so it costs
+// just two acos() - fast enough to follow the +/- autorepeat
+// the times are only displayed, the relays switch by channels[] until the next calc
+// returns: 0=OK, -1=no calc done yet
+int previewSwitchTimes(uint8_t ch)
+{
+    if (switchTimesCalcTS == 0)
+        return -1;
+
+    double altitude = SUNRISESET_STD_ALTITUDE + config.channel[ch].sunAltitude_x10 / 10.0;
+    Channel_s& c = previewTimes;
+    previewChannel = ch;
+    c.onUtc = sunCrossing(onDayEph, altitude, true);
+    c.offUtc = sunCrossing(offDayEph, altitude, false);
+    if (c.offUtc < c.onUtc)
+        c.offUtc = c.onUtc; //polar day, lights stay OFF
+
+    refreshScreen = true;
+    return 0;
+}
+
+
+// switch time of the channel to be displayed (the preview while the channel is edited)
+// inputs: on - true=switch-ON, false=switch-OFF
+// returns: unixtime utc, without delay
+uint32_t displaySwitchUtc(uint8_t ch, bool on)
+{
+    const Channel_s& c = ch == previewChannel ? previewTimes : channels[ch];
+    return on ? c.onUtc : c.offUtc;
+}
+
+
 // test if GPS is responding
 // BUG: this test will indicate an error in first 10sec after device boot
 // return: 0=OK, -1=error
@@ -0,0 +1,360 @@
+/*
+ * backup of the gps receiver almanac/ephemeris in eeprom, restored after power loss
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <TinyGPSPlus.h>
+
+#include "DateTime.h"
+#include "config.h"
+#include "globals.h"
+#include "log.h"
+
+
+#if GPS_BACKUP
+
+// the receiver (u-blox 6) answers the poll of UBX-AID-ALM/EPH by one message per satellite,
+// payload of a satellite with data: svid (U4), week/how (U4), 8 or 24 data words (U4).
+// satellites without data come as 8 byte messages and are not stored
+constexpr uint8_t ubxClassAid = 0x0b;
+constexpr uint8_t ubxIdAlm = 0x30;
+constexpr uint8_t ubxIdEph = 0x31;
+constexpr uint8_t almLength = 40;
+constexpr uint8_t ephLength = 104;
+constexpr uint8_t gpsSvs = 32;
+
+// eeprom map of the backup area:
+// page of the ttff stats - uint16 per start kind (gpsAided), 0xffff=unknown
+// almanac - slot per satellite: payload, checksum
+// ephemeris - slots for the satellites in view: saved (unixtime), payload, checksum
+// the record keeps the UBX checksum of the message, it goes back to the receiver unchanged,
+// so a record torn by a power loss is refused by the receiver
+constexpr uint16_t ttffAddr = gpsBackupAddr;
+constexpr uint16_t almAddr = gpsBackupAddr + eepromPageSize;
+constexpr uint8_t almRecSize = almLength + 2;
+constexpr uint16_t ephAddr = almAddr + gpsSvs * almRecSize;
+constexpr uint8_t ephRecSize = sizeof(uint32_t) + ephLength + 2;
+constexpr uint8_t ephSlots = 10;
+static_assert(ephAddr + ephSlots * ephRecSize <= gpsBackupAddr + gpsBackupSize, "gps backup does not fit its eeprom area");
+
+// ephemeris older than this is not restored, satellites send a new one every 2 hours (secs)
+constexpr uint32_t ephMaxAge = 4ul * 3600ul;
+// the poll is sent once the good fix lasts this long, and then repeated (minutes of uptime)
+// the receiver needs 12.5 min of reception for the whole almanac
+constexpr uint16_t ephPollDelay = 2;
+constexpr uint16_t ephPollPeriod = 60;
+constexpr uint16_t almPollDelay = 15;
+constexpr uint16_t almPollPeriod = 24 * 60;
+constexpr uint16_t neverMinute = 0xffff;
+// records sent to the receiver in one run of gpsBackupSync(), the transmit blocks (~1ms/byte)
+constexpr uint8_t restoreBurst = 2;
+constexpr uint8_t restoreIdle = 0xff;
+
+// head of the ephemeris slot
+struct EphHead_s
+{
+    uint32_t saved;     // unixtime of the last change
+    uint8_t svid;       // low byte of the payload svid
+};
+
+// receiver of the UBX messages
+enum UbxRxState : uint8_t
+{
+    RX_SYNC1 = 0, RX_SYNC2, RX_CLASS, RX_ID, RX_LEN1, RX_LEN2, RX_PAYLOAD, RX_CK_A, RX_CK_B,
+};
+uint8_t rxState = RX_SYNC1;
+uint8_t rxId;
+uint16_t rxLength;
+uint16_t rxPos;
+uint8_t rxCkA, rxCkB;
+// eeprom address of the payload being stored, 0=message is not stored
+uint16_t rxAddr;
+// record differs from the stored one
+bool rxChanged;
+// piece of the payload waiting for the eeprom write
+uint8_t rxPiece[16];
+uint8_t rxFill;
+
+// next record to send to the receiver: ephemeris slots, then almanac slots
+uint8_t restoreNext = restoreIdle;
+// minutes of uptime: since the good fix, of the last polls
+uint16_t goodFixSince = neverMinute;
+uint16_t ephPolled = neverMinute;
+uint16_t almPolled = neverMinute;
+
+// stats: records changed in eeprom
+uint16_t gpsBackupWrites = 0;
+// stats: records sent to the receiver at boot
+uint8_t gpsRestored = 0;
+
+
+
+// eeprom address of the ephemeris slot (its head)
+uint16_t ephSlotAddr(uint8_t slot)
+{
+    return ephAddr + slot * ephRecSize;
+}
+
+
+// find the ephemeris slot of the satellite, otherwise the empty or the oldest one
+// returns: eeprom address of the slot
+uint16_t ephSlotFor(uint8_t svid)
+{
+    uint8_t oldest = 0;
+    uint32_t oldestSaved = 0xfffffffful;
+    for (uint8_t slot = 0; slot < ephSlots; ++slot) {
+        EphHead_s h;
+        eeprom.readBuffer(ephSlotAddr(slot), reinterpret_cast<uint8_t *>(&h), sizeof(h));
+        if (h.svid == svid)
+            return ephSlotAddr(slot);
+        uint32_t saved = (h.svid >= 1 && h.svid <= gpsSvs) ? h.saved : 0; //empty slot is the oldest
+        if (saved < oldestSaved) {
+            oldest = slot;
+            oldestSaved = saved;
+        }
+    }
+    return ephSlotAddr(oldest);
+}
+
+
+// where to store the payload of the received message
+// returns: eeprom address, 0=not stored
+uint16_t rxRecordAddr(uint8_t svid)
+{
+    if (svid < 1 || svid > gpsSvs)
+        return 0;
+    if (rxId == ubxIdAlm && rxLength == almLength)
+        return almAddr + (svid - 1) * almRecSize;
+    if (rxId == ubxIdEph && rxLength == ephLength)
+        return ephSlotFor(svid) + sizeof(uint32_t);
+    return 0;
+}
+
+
+// write the received piece of the payload, if it differs from the record
+void rxFlush()
+{
+    int r = eepromUpdate(rxAddr + rxPos - rxFill, rxPiece, rxFill);
+    if (r > 0)
+        rxChanged = true;
+    else if (r < 0)
+        rxAddr = 0; //give up the message
+    rxFill = 0;
+}
+
+
+// message passed the checksum, store the checksum (the record is complete)
+// and the time of the change of the ephemeris
+void rxCommit()
+{
+    uint8_t ck[2] = {rxCkA, rxCkB};
+    if (eepromUpdate(rxAddr + rxLength, ck, sizeof(ck)) > 0)
+        rxChanged = true;
+    if (!rxChanged)
+        return;
+
+    if (rxId == ubxIdEph) {
+        uint32_t saved = rtcCurrentTime().unixtime();
+        eepromWrite(rxAddr - sizeof(saved), reinterpret_cast<const uint8_t *>(&saved), sizeof(saved));
+    }
+    ++gpsBackupWrites;
+    LOG_D("gps: backup %S sv %u", rxId == ubxIdEph ? PSTR("eph") : PSTR("alm"), eeprom.read(rxAddr));
+}
+
+
+// feed the character from the receiver, AID-ALM/EPH messages are stored into eeprom
+// piece by piece while they are coming, so no RAM buffer of the whole message is needed
+void gpsBackupRx(uint8_t c)
+{
+    switch (rxState) {
+    case RX_SYNC1:
+        if (c == 0xb5)
+            rxState = RX_SYNC2;
+        return;
+    case RX_SYNC2:
+        rxState = c == 0x62 ? RX_CLASS : RX_SYNC1;
+        rxCkA = rxCkB = 0;
+        return;
+    case RX_CLASS:
+        rxState = c == ubxClassAid ? RX_ID : RX_SYNC1;
+        break;
+    case RX_ID:
+        rxId = c;
+        rxState = (c == ubxIdAlm || c == ubxIdEph) ? RX_LEN1 : RX_SYNC1;
+        break;
+    case RX_LEN1:
+        rxLength = c;
+        rxState = RX_LEN2;
+        break;
+    case RX_LEN2:
+        rxLength |= c << 8;
+        rxPos = 0;
+        rxAddr = 0;
+        rxChanged = false;
+        rxFill = 0;
+        rxState = rxLength > 0 ? RX_PAYLOAD : RX_SYNC1;
+        break;
+    case RX_PAYLOAD:
+        if (rxPos == 0)
+            rxAddr = rxRecordAddr(c);
+        ++rxPos;
+        if (rxAddr) {
+            rxPiece[rxFill++] = c;
+            if (rxFill == sizeof(rxPiece) || rxPos == rxLength)
+                rxFlush();
+        }
+        if (rxPos == rxLength)
+            rxState = RX_CK_A;
+        break;
+    case RX_CK_A:
+        rxState = c == rxCkA ? RX_CK_B : RX_SYNC1;
+        return;
+    case RX_CK_B:
+        if (c == rxCkB && rxAddr)
+            rxCommit();
+        rxState = RX_SYNC1;
+        return;
+    }
+    rxCkA += c;
+    rxCkB += rxCkA;
+}
+
+
+// send the stored record to the receiver: UBX header, then payload with the checksum
+// streamed from eeprom piece by piece (read straight from the twi buffer)
+// returns: 0=OK, -1=eeprom error (the receiver refuses the cut message)
+int sendRecord(uint8_t id, uint16_t addr, uint8_t length)
+{
+    ss.write(0xb5);
+    ss.write(0x62);
+    ss.write(ubxClassAid);
+    ss.write(id);
+    ss.write(length);
+    ss.write(static_cast<uint8_t>(0));
+
+    uint8_t left = length + 2;
+    while (left > 0) {
+        uint8_t n = left > BUFFER_LENGTH ? BUFFER_LENGTH : left;
+        Wire.beginTransmission(eepromI2cAddr);
+        Wire.write(static_cast<uint8_t>(addr >> 8));
+        Wire.write(static_cast<uint8_t>(addr & 0xff));
+        if (Wire.endTransmission() != 0 || Wire.requestFrom(eepromI2cAddr, n) != n)
+            return -1;
+        while (Wire.available())
+            ss.write(Wire.read());
+        addr += n;
+        left -= n;
+    }
+    return 0;
+}
+
+
+// send the record to the receiver, if it is valid
+// index - ephemeris slots first (they matter most for the fix), then almanac of the satellites
+// returns: true=sent
+bool restoreRecord(uint8_t index, const DateTime& nowUtc)
+{
+    if (index < ephSlots) {
+        // ephemeris of unknown age is not sent (rtc not valid)
+        EphHead_s h;
+        uint16_t addr = ephSlotAddr(index);
+        eeprom.readBuffer(addr, reinterpret_cast<uint8_t *>(&h), sizeof(h));
+        uint32_t now = nowUtc.unixtime();
+        if (h.svid < 1 || h.svid > gpsSvs || h.saved > now || now - h.saved > ephMaxAge)
+            return false;
+        return sendRecord(ubxIdEph, addr + sizeof(h.saved), ephLength) == 0;
+    }
+
+    uint8_t svid = index - ephSlots + 1;
+    uint16_t addr = almAddr + (svid - 1) * almRecSize;
+    if (eeprom.read(addr) != svid)
+        return false;
+    return sendRecord(ubxIdAlm, addr, almLength) == 0;
+}
+
+
+// start pushing the backup into the receiver (it lost the data with power)
+void gpsBackupRestore()
+{
+    restoreNext = 0;
+}
+
+
+// is the poll due
+bool pollDue(uint16_t polled, uint16_t now, uint16_t period)
+{
+    return polled == neverMinute || static_cast<uint16_t>(now - polled) >= period;
+}
+
+
+// restore the backup in pieces, poll the receiver for the data when the fix is good for a while
+void gpsBackupSync(const DateTime& nowUtc)
+{
+    if (restoreNext != restoreIdle) {
+        // no need to continue with the fix, the transmit blocks the reception
+        uint8_t sent = 0;
+        while (!gps.location.isValid() && restoreNext < ephSlots + gpsSvs && sent < restoreBurst) {
+            if (restoreRecord(restoreNext++, nowUtc))
+                ++sent;
+        }
+        if (sent) {
+            gpsRestored += sent;
+            gpsAided = 2;
+        }
+        if (gps.location.isValid() || restoreNext >= ephSlots + gpsSvs) {
+            LOG_I("gps: backup restored, %u records", gpsRestored);
+            restoreNext = restoreIdle;
+        }
+        return;
+    }
+
+    // good fix: valid, fresh, hdop < 4
+    if (!gps.location.isValid() || gps.location.age() > 2000 || !gps.hdop.isValid() || gps.hdop.value() >= 400) {
+        goodFixSince = neverMinute;
+        return;
+    }
+    uint16_t now = uptimeSecs / 60;
+    if (goodFixSince == neverMinute)
+        goodFixSince = now;
+    uint16_t fixFor = now - goodFixSince;
+
+    // only one poll at a time, the answers take ~1.5s
+    if (fixFor >= ephPollDelay && pollDue(ephPolled, now, ephPollPeriod)) {
+        ephPolled = now;
+        ubxSend(ubxClassAid, ubxIdEph, nullptr, 0);
+        LOG_D("gps: backup poll eph");
+    }
+    else if (fixFor >= almPollDelay && pollDue(almPolled, now, almPollPeriod)) {
+        almPolled = now;
+        ubxSend(ubxClassAid, ubxIdAlm, nullptr, 0);
+        LOG_D("gps: backup poll alm");
+    }
+}
+
+
+// store the ttff of this start (kind - gpsAided)
+void gpsTtffSave(uint8_t kind, uint16_t secs)
+{
+    eepromWrite(ttffAddr + kind * sizeof(secs), reinterpret_cast<const uint8_t *>(&secs), sizeof(secs));
+}
+
+
+// ttff of the last start of the kind (secs), 0=unknown
+uint16_t gpsTtffLast(uint8_t kind)
+{
+    uint16_t secs;
+    eeprom.readBuffer(ttffAddr + kind * sizeof(secs), reinterpret_cast<uint8_t *>(&secs), sizeof(secs));
+    return secs == 0xffff ? 0 : secs;
+}
+
+#endif // GPS_BACKUP
@@ -0,0 +1,189 @@
+/*
+ * fast lcd backend - whole runs of characters in one i2c transfer
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <LCDI2C_Generic.h>
+
+#include "globals.h"
+#include "display.h"
+#include "profiler.h"
+
+
+// i2c address of the PCF8574 backpack (same as for "lcd" object)
+constexpr uint8_t lcdAddr = 0x27;
+// number of characters on one line
+constexpr uint8_t lcdCols = 20;
+
+// PCF8574 pins -> HD44780 signals (usual LCD2004 backpack wiring)
+// P0=RS, P1=RW, P2=EN, P3=backlight, P4..P7=D4..D7
+constexpr uint8_t LCD_RS = 0x01;
+constexpr uint8_t LCD_EN = 0x04;
+constexpr uint8_t LCD_BL = 0x08;
+
+// size of the twi buffer in Wire library (BUFFER_LENGTH)
+constexpr uint8_t wireBufLen = 32;
+
+// DDRAM address of the beginning of each line (20x4 display)
+const uint8_t lcdLineAddr[4] = {0x00, 0x40, 0x14, 0x54};
+
+// line where the next lcdPrintLine() will print
+uint8_t lcdLine = 0;
+// current backlight bit, must be sent with every byte
+uint8_t lcdBacklightBit = 0;
+
+// bytes in currently open transmission (0=no transmission open)
+uint8_t lcdTxLen = 0;
+// mode (RS bit) of the last byte sent
+uint8_t lcdTxMode = 0;
+
+// stats: number of bytes sent on the i2c wire (including address bytes)
+unsigned long lcdBytesOnWire = 0;
+
+
+
+// close currently opened transmission
+void lcdFlush()
+{
+    if (lcdTxLen) {
+        Wire.endTransmission();
+        lcdBytesOnWire += lcdTxLen + 1/*address*/;
+        lcdTxLen = 0;
+    }
+}
+
+
+// queue one byte for the display (as two nibbles with enable strobes)
+// mode - LCD_RS for data, 0 for commands
+void lcdSend(uint8_t value, uint8_t mode)
+{
+    // 4 bytes per character plus a possible RS setup byte
+    if (lcdTxLen + 5 > wireBufLen)
+        lcdFlush();
+
+    if (lcdTxLen == 0) {
+        Wire.beginTransmission(lcdAddr);
+        lcdTxMode = ~mode; //force RS setup byte in a new transmission
+    }
+    if (lcdTxMode != mode) {
+        // RS must be stable before enable goes high
+        Wire.write(mode | lcdBacklightBit);
+        ++lcdTxLen;
+        lcdTxMode = mode;
+    }
+
+    // data is latched on the falling edge of EN. next strobe comes at least
+    // 2 bytes (>=45us at 400kHz) later, so the 37us execution time is met
+    uint8_t hi = (value & 0xf0) | mode | lcdBacklightBit;
+    uint8_t lo = (value << 4) | mode | lcdBacklightBit;
+    Wire.write(hi | LCD_EN);
+    Wire.write(hi);
+    Wire.write(lo | LCD_EN);
+    Wire.write(lo);
+    lcdTxLen += 4;
+}
+
+
+// next lcdPrintLine() prints on the first line
+void lcdHome()
+{
+    lcdLine = 0;
+}
+
+
+// print the string on the current line and advance to the next line
+// string is truncated or padded with spaces to the width of the display
+void lcdPrintLine(const char * str)
+{
+#if LCD_BATCHED
+    // set DDRAM address instead of "home" command which takes 1.5ms
+    lcdSend(0x80 | lcdLineAddr[lcdLine & 0x03], 0);
+
+    uint8_t i = 0;
+    while (i < lcdCols && str[i] != '\0')
+        lcdSend(str[i++], LCD_RS);
+    while (i++ < lcdCols)
+        lcdSend(' ', LCD_RS);
+
+    lcdFlush();
+#else
+    if (lcdLine == 0)
+        lcd.home();
+    lcd.println(str);
+#endif
+    lcdLine = (lcdLine + 1) & 0x03;
+}
+
+
+// switch backlight on/off
+void lcdBacklight(bool on)
+{
+    if (on)
+        lcd.backlight();
+    else
+        lcd.noBacklight();
+    lcdBacklightBit = on ? LCD_BL : 0;
+}
+
+
+// Print in front of the library, counts the characters lcd.println() really writes ("\r\n" incl.)
+struct LcdCountingPrint : public Print
+{
+    unsigned long chars = 0;
+
+    size_t write(uint8_t c) override
+    {
+        ++chars;
+        return lcd.write(c);
+    }
+};
+
+
+// compare lcd.println() against lcdPrintLine(), results to Serial
+// the library writes to the Wire object itself, so its bytes on the wire can not be counted
+// here. they are counted on the bus by tools/sim_bench.cpp between the SIM_MARK_LCD_* markers
+void lcdBenchmark()
+{
+    const char * line = "0123456789ABCDEFGHIJ";
+    constexpr uint8_t rounds = 10; //keep in sync with tools/sim_bench.cpp
+    LcdCountingPrint counter;
+
+    SIM_MARK(SIM_MARK_LCD_PRINTLN);
+    unsigned long t1 = micros();
+    for (uint8_t r = 0; r < rounds; ++r) {
+        lcd.home();
+        counter.println(line);
+    }
+    unsigned long t2 = micros();
+    SIM_MARK(0x80 | SIM_MARK_LCD_PRINTLN);
+
+    unsigned long bytes = lcdBytesOnWire;
+    SIM_MARK(SIM_MARK_LCD_BATCHED);
+    unsigned long t3 = micros();
+    for (uint8_t r = 0; r < rounds; ++r) {
+        lcdHome();
+        lcdPrintLine(line);
+    }
+    unsigned long t4 = micros();
+    SIM_MARK(0x80 | SIM_MARK_LCD_BATCHED);
+    bytes = lcdBytesOnWire - bytes;
+
+    Serial.print(F("lcd println: us/line="));
+    Serial.print((t2 - t1) / rounds);
+    Serial.print(F(" chars/line="));
+    Serial.println(counter.chars / rounds);
+    Serial.print(F("lcd batched: us/line="));
+    Serial.print((t4 - t3) / rounds);
+    Serial.print(F(" bytes/line="));
+    Serial.println(bytes / rounds);
+}
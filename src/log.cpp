@@ -0,0 +1,144 @@
+/*
+ * non-blocking debug log to the serial console
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "log.h"
+#include "printnum.h"
+
+
+// messages above this level are dropped at runtime
+uint8_t logLevel = LOG_LEVEL;
+// number of messages dropped because the serial transmit buffer was full
+uint16_t logDropped = 0;
+
+
+
+#if !LOG_PRINTF
+// append char to buf if there is space left
+inline void logPut(char * buf, uint8_t& n, uint8_t size, char c)
+{
+    if (n < size)
+        buf[n++] = c;
+}
+
+
+// format the message into buf (not terminated), the subset of printf used by the log:
+// %d %u %ld %lu %c %s %S %%, flag 0 and width (for numbers)
+// returns: length of the message, truncated to size
+uint8_t logFormat_P(char * buf, uint8_t size, const char * fmt, va_list args)
+{
+    uint8_t n = 0;
+    char c;
+    while ((c = pgm_read_byte(fmt++)) != '\0') {
+        if (c != '%') {
+            logPut(buf, n, size, c);
+            continue;
+        }
+
+        c = pgm_read_byte(fmt++);
+        char pad = ' ';
+        if (c == '0') {
+            pad = '0';
+            c = pgm_read_byte(fmt++);
+        }
+        uint8_t width = 0;
+        while (c >= '0' && c <= '9') {
+            width = width * 10 + (c - '0');
+            c = pgm_read_byte(fmt++);
+        }
+        bool isLong = c == 'l';
+        if (isLong)
+            c = pgm_read_byte(fmt++);
+
+        if (c == 'd' || c == 'u') {
+            uint32_t v;
+            bool neg = false;
+            if (c == 'd') {
+                long s = isLong ? va_arg(args, long) : va_arg(args, int);
+                neg = s < 0;
+                v = neg ? -static_cast<uint32_t>(s) : s;
+            }
+            else
+                v = isLong ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+
+            // digits reversed
+            char tmp[10];
+            uint8_t i = 0;
+            do {
+                tmp[i++] = '0' + divmod10(v);
+            }
+            while (v);
+
+            if (neg && pad == '0')
+                logPut(buf, n, size, '-');
+            for (uint8_t w = i + neg; w < width; ++w)
+                logPut(buf, n, size, pad);
+            if (neg && pad == ' ')
+                logPut(buf, n, size, '-');
+            while (i > 0)
+                logPut(buf, n, size, tmp[--i]);
+        }
+        else if (c == 'c')
+            logPut(buf, n, size, static_cast<char>(va_arg(args, int)));
+        else if (c == 's') {
+            const char * s = va_arg(args, const char *);
+            while (*s)
+                logPut(buf, n, size, *s++);
+        }
+        else if (c == 'S') {
+            const char * s = va_arg(args, const char *);
+            char sc;
+            while ((sc = pgm_read_byte(s++)) != '\0')
+                logPut(buf, n, size, sc);
+        }
+        else if (c == '\0')
+            break; //% at the end
+        else
+            logPut(buf, n, size, c); //%% and unknown conversions
+    }
+    return n;
+}
+#endif
+
+
+// print one line to Serial, format string is in flash
+// the ring buffer of HardwareSerial (64 bytes) is used as the log buffer,
+// message is dropped (not waited for) when it does not fit in
+void logPrint_P(uint8_t level, const char * fmt, ...)
+{
+    if (level > logLevel)
+        return;
+
+    // the longest line that fits into the empty transmit buffer
+    char buf[SERIAL_TX_BUFFER_SIZE - 1];
+    va_list args;
+    va_start(args, fmt);
+#if LOG_PRINTF
+    int n = vsnprintf_P(buf, sizeof(buf) - 2, fmt, args);
+    if (n > static_cast<int>(sizeof(buf)) - 3)
+        n = sizeof(buf) - 3; //truncated
+#else
+    int n = logFormat_P(buf, sizeof(buf) - 2, fmt, args);
+#endif
+    va_end(args);
+    buf[n++] = '\r';
+    buf[n++] = '\n';
+
+    if (Serial.availableForWrite() < n) {
+        ++logDropped;
+        return;
+    }
+    Serial.write(reinterpret_cast<const uint8_t *>(buf), n);
+}
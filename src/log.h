@@ -0,0 +1,73 @@
+/*
+ * non-blocking debug log to the serial console
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#pragma once
+#ifndef __LOG_H__
+#define __LOG_H__
+
+#include <avr/pgmspace.h>
+
+
+// log levels
+#define LOG_NONE  0
+#define LOG_ERROR 1
+#define LOG_WARN  2
+#define LOG_INFO  3
+#define LOG_DEBUG 4
+
+// messages above this level are not compiled in at all (their strings do not take flash)
+#define LOG_LEVEL LOG_INFO
+
+// 1=format the messages by vsnprintf_P (full printf, costs ~1.5 KB of flash for vfprintf)
+// 0=built-in formatter of %d %u %ld %lu %c %s %S %% with optional zero/width (eg. %02u)
+#ifndef LOG_PRINTF
+#define LOG_PRINTF 0
+#endif
+
+// messages are printed with printf-like format stored in flash
+// (no floats, %ld for long, %S for string in flash)
+#if LOG_LEVEL >= LOG_ERROR
+#define LOG_E(fmt, ...) logPrint_P(LOG_ERROR, PSTR(fmt), ##__VA_ARGS__)
+#else
+#define LOG_E(fmt, ...)
+#endif
+
+#if LOG_LEVEL >= LOG_WARN
+#define LOG_W(fmt, ...) logPrint_P(LOG_WARN, PSTR(fmt), ##__VA_ARGS__)
+#else
+#define LOG_W(fmt, ...)
+#endif
+
+#if LOG_LEVEL >= LOG_INFO
+#define LOG_I(fmt, ...) logPrint_P(LOG_INFO, PSTR(fmt), ##__VA_ARGS__)
+#else
+#define LOG_I(fmt, ...)
+#endif
+
+#if LOG_LEVEL >= LOG_DEBUG
+#define LOG_D(fmt, ...) logPrint_P(LOG_DEBUG, PSTR(fmt), ##__VA_ARGS__)
+#else
+#define LOG_D(fmt, ...)
+#endif
+
+
+// messages above this level are dropped at runtime (default LOG_LEVEL)
+extern uint8_t logLevel;
+// number of messages dropped because the serial transmit buffer was full
+extern uint16_t logDropped;
+
+// print one line to Serial, format string is in flash
+// message is dropped (not waited for) when it does not fit into the serial transmit buffer
+void logPrint_P(uint8_t level, const char * fmt, ...);
+
+
+#endif // __LOG_H__
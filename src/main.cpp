@@ -17,12 +17,14 @@
 #include <uRTCLib.h>
 #include <at24c32.h>
 #include <LCDI2C_Generic.h>
-#include <Mini_Button.h>
 
 #include "DateTime.h"
 #include "config.h"
 #include "display.h"
 #include "globals.h"
+#include "log.h"
+#include "profiler.h"
+#include "scheduler.h"
 
 
 /**** GLOBALS ****/
@@ -36,20 +38,166 @@ SoftwareSerial ss(4/*RXpin*/, 3/*TXpin*/);
 uRTCLib rtc(0x68); //i2c addr
 
 // eeprom memory 4096 bytes
-AT24C32 eeprom(0x57); //i2c addr
+AT24C32 eeprom(eepromI2cAddr);
 
 // lcd display
 LCDI2C_Generic lcd(0x27, 20, 4);  // I2C address: 0x27; Display size: 20x4
 
-// buttons
-Button buttonSelect(9/*pin*/);
-AutoRepeatButton buttonPlus(8/*pin*/, 1000/*delay*/, 100/*rate*/);
-AutoRepeatButton buttonMinus(7/*pin*/, 1000/*delay*/, 100/*rate*/);
-LongPressDetector detectReset(&buttonSelect, 3000);
-
 // uptime counter (secs)
 unsigned long uptimeSecs = 0;
 
+#if LOOP_BENCHMARK
+// number of loop() runs since the last tick
+unsigned int loopCount = 0;
+#endif
+
+
+
+/**** TASKS ****/
+
+// current time (UTC), read from RTC by tickTask()
+DateTime nowUtc;
+// tickTask() has run and display should be updated
+bool tickDone = false;
+
+
+// handle button events queued by the interrupt
+void buttonsTask()
+{
+    PROF_BEGIN(PROF_BUTTONS);
+    handleButtons();
+    PROF_END(PROF_BUTTONS);
+
+    // keypress or changed config - refresh everything right now
+    if (refreshScreen)
+        scheduleNow(tasks[TASK_TICK]);
+}
+
+
+// drain characters received from gps
+// SoftwareSerial buffer (64 bytes) gets full in ~66ms at 9600 baud
+void gpsTask()
+{
+    PROF_BEGIN(PROF_GPS_DRAIN);
+    while (ss.available()) {
+        char c = ss.read();
+        gps.encode(c);
+#if GPS_BACKUP
+        gpsBackupRx(c);
+#endif
+    }
+    PROF_END(PROF_GPS_DRAIN);
+}
+
+
+// once per second: read RTC, calculate switch times and control the switch
+void tickTask()
+{
+    // timestamp (from millis()) of the last tick
+    static unsigned long last = 0;
+    // accumulator of milisecs for updating uptime counter
+    static unsigned int acc = 0;
+    // generation of config already processed
+    static uint8_t configSeen = 0;
+
+    unsigned long now = millis();
+
+    // update uptime counter
+    acc += now - last;
+    uptimeSecs += acc / 1000;
+    acc %= 1000;
+    last = now;
+
+    // cpu load in the last second
+    idleStatsUpdate();
+
+#if LOOP_BENCHMARK
+    LOG_I("loops=%u active=%u%% logDropped=%u", loopCount, activePercent, logDropped);
+    loopCount = 0;
+#endif
+
+    // get fresh time from RTC
+    rtc.refresh();
+    nowUtc = rtcCurrentTime();
+
+    // if config has changed (it will be saved later, when changes settle down)
+    bool recalc = false;
+    if (configGeneration != configSeen) {
+        configSeen = configGeneration;
+        recalc = true;
+        refreshScreen = true;
+    }
+
+    PROF_BEGIN(PROF_CALC);
+    calculateSwitchTimes(nowUtc, recalc);
+    PROF_END(PROF_CALC);
+
+    PROF_BEGIN(PROF_SWITCH);
+    checkSwitch(nowUtc);
+    PROF_END(PROF_SWITCH);
+
+#if TELEMETRY
+    sendTelemetry(nowUtc);
+#endif
+
+#if LOG_LEVEL >= LOG_DEBUG
+    char buf[32];
+    printDateTime(buf, nowUtc);
+    LOG_D("%lu %s %S", now, buf, switchIsOn() ? PSTR("ON") : PSTR("OFF"));
+#endif
+
+#if LOOP_BENCHMARK
+    if (nowUtc.second() == 0)
+        printTaskStats(tasks, TASKS_COUNT);
+#endif
+
+    tickDone = true;
+}
+
+
+// redraw display after tick or keypress
+void displayTask()
+{
+    if (!tickDone && !refreshScreen)
+        return;
+    tickDone = false;
+
+    PROF_BEGIN(PROF_DISPLAY);
+    display(nowUtc);
+    PROF_END(PROF_DISPLAY);
+}
+
+
+// resync time and position from gps, persist changes
+void syncTask()
+{
+    PROF_BEGIN(PROF_GPS_SYNC);
+    gpsSync(nowUtc);
+    PROF_END(PROF_GPS_SYNC);
+#if GPS_BACKUP
+    gpsBackupSync(nowUtc);
+#endif
+#if DCF77
+    dcfSync(nowUtc);
+#endif
+
+    configCommit();
+    eventLogFlush();
+}
+
+
+// task table: function, period (ms), deadline (ms)
+// buttons and gps are polled often, the rest is spread over the second
+Task_s tasks[TASKS_COUNT] = {
+    {buttonsTask, 10, 50},
+    {gpsTask, 10, 50},
+    {tickTask, 1000, 100},
+    {displayTask, 50, 200},
+    {syncTask, 1000, 500},
+#if SHELL
+    {shellTask, 10, 200},
+#endif
+};
 
 
 /**** MAIN ****/
@@ -57,6 +205,7 @@ unsigned long uptimeSecs = 0;
 void setup()
 {
     // put your setup code here, to run once:
+    powerInit();
     Serial.begin(115200);
     while (!Serial) {
         ;
@@ -75,16 +224,15 @@ void setup()
     rtc.set_model(URTCLIB_MODEL_DS3231);
     //rtc.set_12hour_mode(false); //24h mode
     if (!rtc.enableBattery()) {
-        Serial.println("RTC: battery error!");
+        LOG_E("RTC: battery error!");
         //const char * msg[] = {"RTC:", "battery error!", ""};
         //debugPrint(msg);
     }
     // refresh data from RTC HW in RTC class object so flags like rtc.lostPower(), rtc.getEOSCFlag(), etc, can get populated
     rtc.refresh();
-    if (rtc.lostPower()) {
-        Serial.print("RTC: power lost");
-        Serial.print(" - resetting!");
-        Serial.println();
+    bool rtcLostPower = rtc.lostPower();
+    if (rtcLostPower) {
+        LOG_W("RTC: power lost - resetting!");
         //const char * msg[] = {"RTC:", "power lost", " - resetting!", ""};
         //debugPrint(msg);
         // RTCLib::set(byte second, byte minute, byte hour, byte dayOfWeek, byte dayOfMonth, byte month, byte year)
@@ -92,101 +240,81 @@ void setup()
         rtc.lostPowerClear();
     }
 
+    // continue in the event log
+    eventLogInit();
+#if EVENTLOG_DUMP_AT_BOOT
+    eventLogDump();
+#endif
+    logEvent(EV_BOOT);
+    if (rtcLostPower)
+        logEvent(EV_RTC_LOST_POWER);
+
+    // rtc of unknown age, any time source with a fix may correct it
+    bool rtcValid = !rtcLostPower && rtcCurrentTime().year() > 2000;
+    timeSourceInit(rtcValid);
+
     // load config
     if (config.loadData() < 0) {
         // config is not valid
-        Serial.print("EEPROM: invalid content");
-        Serial.print(" - resetting!");
-        Serial.println();
+        LOG_W("EEPROM: invalid content - resetting!");
         //const char * msg[] = {"EEPROM:", "invalid content", " - resetting!", ""};
         //debugPrint(msg);
         config = Config_s(); //reseting with defaults
         config.updateCrc();
         config.saveData();
+        logEvent(EV_CONFIG_RESET, 0);
     }
     config.debugPrint();
 
+    // position and time for the gps receiver are known now
+    gpsStart(rtcValid);
+
+#if DCF77
+    // before the buttons, they start the sampling interrupt
+    initDcf();
+#endif
+
     // buttons init
-    buttonSelect.begin();
-    buttonPlus.begin();
-    buttonMinus.begin();
-    detectReset.begin();
+    initButtons();
+
+    // all i2c devices are initialized, now it is safe to speed up the bus
+#if I2C_FAST_MODE
+    Wire.setClock(400000ul);
+#endif
+
+#if LCD_BENCHMARK
+    lcdBenchmark();
+#endif
+#if PRINT_BENCHMARK
+    printBenchmark();
+#endif
 
     // print misc info
     debugInfo();
+
+    // first runs are due from now, the time of setup() is not their lateness
+    // spread the 1sec tasks over the second
+    unsigned long nowTS = millis();
+    for (uint8_t i = 0; i < TASKS_COUNT; ++i)
+        tasks[i].dueTS = nowTS;
+    tasks[TASK_SYNC].dueTS = nowTS + 500;
 }
 
 
 void loop()
 {
     // put your main code here, to run repeatedly:
-    // timestamp (from millis()) of the last screen update (not loop() run!!)
-    static unsigned long last = 0;
-    // accumulator of milisecs for updating uptime counter
-    static unsigned int acc = 0;
+#if LOOP_BENCHMARK
+    ++loopCount;
+#endif
 
-    unsigned long now = millis();
-    //Serial.println(now);
+    PROF_BEGIN(PROF_LOOP);
+    bool ran = runTasks(tasks, TASKS_COUNT);
+    PROF_END(PROF_LOOP);
 
-    rtc.refresh();
-
-    // if config has changed
-    bool recalc = false;
-    if (!config.isCrcValid()) {
-        recalc = true;
-        refreshScreen = true;
-        config.updateCrc();
-        config.saveData();
-        config.debugPrint();
-    }
-
-    // refresh things - do once per second
-    if (refreshScreen || (now - last) >= 999/*little bit less than 1sec*/) {
-
-        Serial.print(now);
-        Serial.print(" \t");
-
-        // update uptime counter
-        acc += now - last;
-        uptimeSecs += acc / 1000;
-        acc %= 1000;
-
-        // get fresh time from RTC
-        DateTime nowUtc = rtcCurrentTime();
-        char buf[32];
-        printDateTime(buf, nowUtc);
-        Serial.print(buf);
-        Serial.print(" \t");
-
-        // resync locality and rtc if necessary
-        gpsSync(nowUtc);
-
-        handleButtons(); //call often
-
-        calculateSwitchTimes(nowUtc, recalc);
-        checkSwitch(nowUtc);
-
-        handleButtons(); //call often
-
-unsigned long t1, t2;
-t1=millis();
-        // refresh display
-        display(nowUtc);
-t2=millis();Serial.print("display(): ");Serial.println(t2-t1);
-
-        handleButtons(); //call often
-
-        // notice timestamp of the last "refresh"
-        last = now;
-    }
-
-    // handle gps
-    while (ss.available()) {
-        gps.encode(ss.read());
-    }
-
-    // handle buttons - call often
-    handleButtons();
+    // sleep till the next interrupt when nothing is due
+    if (!ran)
+        idle();
 }
 
 
@@ -220,14 +348,6 @@ void debugInfo()
     Serial.println(sizeof(eeprom));
     Serial.print("sizeof(lcd)=");
     Serial.println(sizeof(lcd));
-    Serial.print("sizeof(buttonSelect)=");
-    Serial.println(sizeof(buttonSelect));
-    Serial.print("sizeof(buttonPlus)=");
-    Serial.println(sizeof(buttonPlus));
-    Serial.print("sizeof(buttonMinus)=");
-    Serial.println(sizeof(buttonMinus));
-    Serial.print("sizeof(detectReset)=");
-    Serial.println(sizeof(detectReset));
     Serial.print("sizeof(uptimeSecs)=");
     Serial.println(sizeof(uptimeSecs));*/
     
@@ -0,0 +1,74 @@
+/*
+ * idle sleep between the tasks
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+#include <avr/power.h>
+#include <avr/sleep.h>
+
+#include "globals.h"
+
+
+// share of the time the cpu was running (not sleeping) in the last window (%)
+uint8_t activePercent = 100;
+
+// time slept in the current window (usec)
+unsigned long idleUs = 0;
+// start of the current window (micros())
+unsigned long idleWindowTS = 0;
+
+
+
+// switch off the peripherals nobody uses, they would draw current even in sleep
+// timer0 (millis), usart (Serial), twi (i2c) and pin change/external interrupts must stay on
+void powerInit()
+{
+    ADCSRA &= ~_BV(ADEN); //adc must be disabled before its clock is stopped
+    power_adc_disable();
+    power_spi_disable();
+    power_timer1_disable();
+    power_timer2_disable();
+}
+
+
+// sleep till the next interrupt, call when there is nothing to do
+// only idle mode is possible: SoftwareSerial receives gps data bit by bit in the pin change
+// interrupt with cpu timing, and millis() needs timer0. so the cpu is woken by timer0 every
+// 1.024ms at the latest (button polling keeps its latency), by usart rx from the console,
+// by pin change from gps data and by INT0 from the rtc alarm
+void idle()
+{
+#if IDLE_SLEEP
+    unsigned long t = micros();
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    sleep_enable();
+    sei(); //the instruction after sei is executed before any interrupt, so no wake-up is lost
+    sleep_cpu();
+    sleep_disable();
+
+    idleUs += micros() - t;
+#endif
+}
+
+
+// close the measurement window, compute activePercent
+// call periodically (every second)
+void idleStatsUpdate()
+{
+    unsigned long now = micros();
+    unsigned long window = now - idleWindowTS;
+    if (window > 0 && idleUs <= window)
+        activePercent = 100 - (idleUs / (window / 100 + 1));
+    idleUs = 0;
+    idleWindowTS = now;
+}
@@ -11,50 +11,11 @@
  */
 
 #include <math.h>
+#include <avr/pgmspace.h>
 
 #include "DateTime.h"
 #include "globals.h"
-
-
-// print integer number into char buf[] - chatGPT recommended
-// buf - must be long enough to store the number
-// value - a number to print
-// reserve - how many places to reserve for right-aligning the number
-// returns: length of the output string stored in buf
-int printInt(char * buf, int value, bool forceSign=false, int8_t reserve=0, bool trailingZero=true)
-{
-    bool neg = value < 0;
-    if (neg)
-        value = -value;
-
-    char tmp[12];
-    int i = 0;
-    do {
-        tmp[i++] = '0' + (value % 10);
-        value /= 10;
-    }
-    while (value);
-
-    if (neg)
-        tmp[i++] = '-';
-    else if (forceSign)
-        tmp[i++] = '+';
-
-    int r = reserve - i;
-    if (r < 0)
-        r = 0;
-
-    // reverse
-    int j = 0;
-    while (j < r)
-        buf[j++] = ' ';
-    while (i > 0)
-        buf[j++] = tmp[--i];
-
-    if (trailingZero)
-        buf[j] = '\0';
-    return j;
-}
+#include "printnum.h"
 
 
 // print float number into char buf[] - chatGPT recommended
@@ -158,6 +119,29 @@ int printString(char * buf, const char * value, int8_t reserve=0, bool trailingZ
 }
 
 
+// copy string stored in flash (PROGMEM) into char buf
+// returns: length of the output string stored in buf
+int printString_P(char * buf, const char * value, int8_t reserve, bool trailingZero)
+{
+    int i = strlen_P(value);
+
+    int r = reserve - i;
+    if (r < 0)
+        r = 0;
+
+    // copy result into output
+    int j = 0;
+    while (j < r)
+        buf[j++] = ' ';
+    memcpy_P(buf + j, value, i);
+    j += i;
+
+    if (trailingZero)
+        buf[j] = '\0';
+    return j;
+}
+
+
 #if 0
 // print delay (millis) in form from msec to days
 // returns: length of the output string stored in buf
@@ -338,3 +322,44 @@ int printDateTime(char * buf, const DateTime& dateTime, int8_t precision=3, bool
     return j;
 }
 
+
+#if PRINT_BENCHMARK
+// compare the float and fixed-point formatting of the display fields, results to Serial
+// cycles/call = us * 16 (16MHz) / rounds
+void printBenchmark()
+{
+    char buf[16];
+    constexpr uint8_t rounds = 100;
+    volatile float lat = 49.1234f;      //volatile, so the compiler does not fold the calls
+    volatile long latFixed = 491234;
+    volatile int16_t alt = -65;
+
+    unsigned long t1 = micros();
+    for (uint8_t r = 0; r < rounds; ++r)
+        printFloat(buf, lat, 4, false, 7);
+    unsigned long t2 = micros();
+    for (uint8_t r = 0; r < rounds; ++r)
+        printFixed(buf, latFixed, 4, false, 7);
+    unsigned long t3 = micros();
+    for (uint8_t r = 0; r < rounds; ++r)
+        printFloat(buf, alt / 10.0f, 1, true, 6);
+    unsigned long t4 = micros();
+    for (uint8_t r = 0; r < rounds; ++r)
+        printFixed(buf, alt, 1, true, 6);
+    unsigned long t5 = micros();
+    for (uint8_t r = 0; r < rounds; ++r)
+        printInt(buf, alt * 500, false, 7);
+    unsigned long t6 = micros();
+
+    Serial.print(F("print cycles: float4="));
+    Serial.print((t2 - t1) * 16ul / rounds);
+    Serial.print(F(" fixed4="));
+    Serial.print((t3 - t2) * 16ul / rounds);
+    Serial.print(F(" float1s="));
+    Serial.print((t4 - t3) * 16ul / rounds);
+    Serial.print(F(" fixed1s="));
+    Serial.print((t5 - t4) * 16ul / rounds);
+    Serial.print(F(" int="));
+    Serial.println((t6 - t5) * 16ul / rounds);
+}
+#endif
@@ -0,0 +1,92 @@
+/*
+ * integer and fixed-point number formatting
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include "printnum.h"
+
+
+// copy digits (reversed in tmp) into buf, right aligned to reserve
+// returns: length of the output string stored in buf
+int printReversed(char * buf, const char * tmp, int8_t i, int8_t reserve, bool trailingZero)
+{
+    int8_t r = reserve - i;
+    if (r < 0)
+        r = 0;
+
+    int j = 0;
+    while (j < r)
+        buf[j++] = ' ';
+    while (i > 0)
+        buf[j++] = tmp[--i];
+
+    if (trailingZero)
+        buf[j] = '\0';
+    return j;
+}
+
+
+// print integer number into char buf[]
+// buf - must be long enough to store the number
+// value - a number to print
+// reserve - how many places to reserve for right-aligning the number
+// returns: length of the output string stored in buf
+int printInt(char * buf, int value, bool forceSign, int8_t reserve, bool trailingZero)
+{
+    bool neg = value < 0;
+    // unsigned, so -32768 works too
+    uint16_t v = neg ? -static_cast<uint16_t>(value) : value;
+
+    char tmp[8];
+    int8_t i = 0;
+    do {
+        tmp[i++] = '0' + divmod10(v);
+    }
+    while (v);
+
+    if (neg)
+        tmp[i++] = '-';
+    else if (forceSign)
+        tmp[i++] = '+';
+
+    return printReversed(buf, tmp, i, reserve, trailingZero);
+}
+
+
+// print fixed-point number (value / 10^decimals) into char buf[], no float math
+// buf - must be long enough to store the number
+// decimals - how many decimal places are in value
+// reserve - how many places to reserve for right-aligning the number
+// returns: length of the output string stored in buf
+int printFixed(char * buf, long value, uint8_t decimals, bool forceSign, int8_t reserve, bool trailingZero)
+{
+    bool neg = value < 0;
+    uint32_t v = neg ? -static_cast<uint32_t>(value) : value;
+
+    char tmp[16];
+    int8_t i = 0;
+    if (decimals > 0) {
+        // fraction digits, then the decimal point
+        while (i < decimals)
+            tmp[i++] = '0' + divmod10(v);
+        tmp[i++] = '.';
+    }
+    do {
+        tmp[i++] = '0' + divmod10(v);
+    }
+    while (v);
+
+    if (neg)
+        tmp[i++] = '-';
+    else if (forceSign)
+        tmp[i++] = '+';
+
+    return printReversed(buf, tmp, i, reserve, trailingZero);
+}
@@ -0,0 +1,67 @@
+/*
+ * integer and fixed-point number formatting without float math and without the
+ * library division (AVR has no divider, / and % by 10 are a ~200 cycle loop each)
+ * no Arduino dependency, so the same code runs in tools/print_test.cpp
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#pragma once
+#ifndef __PRINTNUM_H__
+#define __PRINTNUM_H__
+
+#include <stdint.h>
+
+
+// n /= 10, returns the remainder
+// 16 bit: multiply by the reciprocal (0xcccd / 2^19), exact for all values
+inline uint8_t divmod10(uint16_t& n)
+{
+    uint16_t q = (static_cast<uint32_t>(n) * 0xcccdu) >> 19;
+    uint8_t r = n - q * 10;
+    n = q;
+    return r;
+}
+
+// n /= 10, returns the remainder
+// 32 bit: shifts and adds give n*0.8 (low by at most 1 after >>3), fixed by the remainder
+inline uint8_t divmod10(uint32_t& n)
+{
+    uint32_t q = (n >> 1) + (n >> 2);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    q >>= 3;
+    uint8_t r = n - ((q << 3) + (q << 1));
+    if (r > 9) {
+        ++q;
+        r -= 10;
+    }
+    n = q;
+    return r;
+}
+
+
+// print integer number into char buf[]
+// buf - must be long enough to store the number
+// value - a number to print
+// reserve - how many places to reserve for right-aligning the number
+// returns: length of the output string stored in buf
+int printInt(char * buf, int value, bool forceSign=false, int8_t reserve=0, bool trailingZero=true);
+
+// print fixed-point number (value / 10^decimals) into char buf[], no float math
+// eg. tenths of degrees: printFixed(buf, -65, 1) = "-6.5"
+// buf - must be long enough to store the number
+// decimals - how many decimal places are in value
+// reserve - how many places to reserve for right-aligning the number
+// returns: length of the output string stored in buf
+int printFixed(char * buf, long value, uint8_t decimals=1, bool forceSign=false, int8_t reserve=0, bool trailingZero=true);
+
+
+#endif // __PRINTNUM_H__
@@ -0,0 +1,97 @@
+/*
+ * profiler of the main tasks
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+
+#include "profiler.h"
+
+#if PROFILER
+
+
+// stats of all slots
+ProfStats_s profStats[PROF_SLOTS];
+
+// names of the slots for profDump()
+const char profName0[] PROGMEM = "gpsSync";
+const char profName1[] PROGMEM = "calc";
+const char profName2[] PROGMEM = "switch";
+const char profName3[] PROGMEM = "display";
+const char profName4[] PROGMEM = "buttons";
+const char profName5[] PROGMEM = "gpsDrain";
+const char profName6[] PROGMEM = "localTime";
+const char profName7[] PROGMEM = "loop";
+const char * const profNames[PROF_SLOTS] PROGMEM = {
+    profName0, profName1, profName2, profName3, profName4, profName5, profName6, profName7
+};
+
+
+
+// add one measured time into the stats
+void profAdd(uint8_t slot, unsigned long us)
+{
+    ProfStats_s& st = profStats[slot];
+
+    if (st.count == 0 || us < st.min)
+        st.min = us;
+    if (us > st.max)
+        st.max = us;
+
+    // restart averaging before the sum or count overflows
+    if (st.count == 0xffff || st.sum + us < st.sum) {
+        st.sum = 0;
+        st.count = 0;
+    }
+    st.sum += us;
+    ++st.count;
+
+    // bucket by powers of 4, starting at 64us
+    uint8_t b = 0;
+    for (us >>= 6; us && b < profBuckets - 1; us >>= 2)
+        ++b;
+    if (st.hist[b] < 0xffff)
+        ++st.hist[b];
+}
+
+
+// print one line of the stats to Serial: 0=header, 1..PROF_SLOTS=the slots
+void profDump(uint8_t line)
+{
+    if (line == 0) {
+        Serial.println(F("prof: name min avg max [<64us <256us <1ms <4ms <16ms <65ms <262ms more]"));
+        return;
+    }
+    const ProfStats_s& st = profStats[line - 1];
+    Serial.print(reinterpret_cast<const __FlashStringHelper *>(pgm_read_ptr(&profNames[line - 1])));
+    Serial.print(' ');
+    Serial.print(st.min);
+    Serial.print(' ');
+    Serial.print(st.count ? st.sum / st.count : 0);
+    Serial.print(' ');
+    Serial.print(st.max);
+    Serial.print(F(" ["));
+    for (uint8_t b = 0; b < profBuckets; ++b) {
+        if (b)
+            Serial.print(' ');
+        Serial.print(st.hist[b]);
+    }
+    Serial.println(']');
+}
+
+
+// reset all stats
+void profReset()
+{
+    memset(profStats, 0, sizeof(profStats));
+}
+
+
+#endif // PROFILER
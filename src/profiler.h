@@ -0,0 +1,91 @@
+/*
+ * profiler of the main tasks
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#pragma once
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+
+// 1=measure run times of the tasks (costs ~240 bytes of RAM), 0=compiled out for production
+#define PROFILER 0
+// 1=write the slot into GPIOR0 at PROF_BEGIN/PROF_END (1 cycle each), for the cycle counts
+// of tools/sim_bench.cpp under simavr (set by -DSIM_MARKERS=1 of that build). the register
+// is not used by anything else
+#ifndef SIM_MARKERS
+#define SIM_MARKERS 0
+#endif
+
+// measured pieces of code
+enum ProfSlot : uint8_t
+{
+    PROF_GPS_SYNC = 0,  // gpsSync()
+    PROF_CALC,          // calculateSwitchTimes()
+    PROF_SWITCH,        // checkSwitch()
+    PROF_DISPLAY,       // display()
+    PROF_BUTTONS,       // handleButtons()
+    PROF_GPS_DRAIN,     // feeding gps chars into TinyGPSPlus
+    PROF_LOCALTIME,     // localDateTime()
+    PROF_LOOP,          // one loop() run without the idle sleep
+    PROF_SLOTS
+};
+
+// histogram buckets: <64us, <256us, <1ms, <4ms, <16ms, <65ms, <262ms, more
+constexpr uint8_t profBuckets = 8;
+
+// stats of one slot (times in usec)
+struct ProfStats_s
+{
+    uint32_t min;
+    uint32_t max;
+    uint32_t sum;
+    uint16_t count;
+    uint16_t hist[profBuckets];
+};
+
+
+// GPIOR0 marker: slot+1 at the begin, 0x80|(slot+1) at the end
+#if SIM_MARKERS
+#define SIM_MARK(v) GPIOR0 = (v)
+#else
+#define SIM_MARK(v)
+#endif
+
+// GPIOR0 markers of lcdBenchmark() (lcdfast.cpp) outside the slot range, 0x80|marker at the end
+// tools/sim_bench.cpp counts the lcd bytes on the wire between them
+constexpr uint8_t SIM_MARK_LCD_PRINTLN = 0x40;
+constexpr uint8_t SIM_MARK_LCD_BATCHED = 0x41;
+
+#if PROFILER
+
+extern ProfStats_s profStats[PROF_SLOTS];
+
+// start measuring
+#define PROF_BEGIN(slot) SIM_MARK((slot) + 1); unsigned long _prof_##slot = micros()
+// stop measuring and add the time into the stats
+#define PROF_END(slot) profAdd(slot, micros() - _prof_##slot); SIM_MARK(0x80 | ((slot) + 1))
+
+// add one measured time into the stats
+void profAdd(uint8_t slot, unsigned long us);
+// print one line of the stats to Serial: 0=header, 1..PROF_SLOTS=the slots
+void profDump(uint8_t line);
+// reset all stats
+void profReset();
+
+#else
+
+#define PROF_BEGIN(slot) SIM_MARK((slot) + 1)
+#define PROF_END(slot) SIM_MARK(0x80 | ((slot) + 1))
+
+#endif // PROFILER
+
+
+#endif // __PROFILER_H__
@@ -0,0 +1,92 @@
+/*
+ * cooperative task scheduler
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+
+#include "scheduler.h"
+
+
+// stats: the longest run of a task since the reset by the reader (usec, 0xffff=longer), index of the task
+uint16_t runMaxUs = 0;
+uint8_t runMaxTask = 0;
+
+
+// run one due task, the one with the nearest deadline
+// returns: true=task was run, false=nothing due
+bool runTasks(Task_s * tasks, uint8_t count)
+{
+    unsigned long nowTS = millis();
+
+    // earliest deadline first
+    Task_s * task = nullptr;
+    long slack = 0;
+    for (uint8_t i = 0; i < count; ++i) {
+        long late = static_cast<long>(nowTS - tasks[i].dueTS);
+        if (late < 0)
+            continue; //not due yet
+        long s = static_cast<long>(tasks[i].deadline) - late;
+        if (task == nullptr || s < slack) {
+            task = &tasks[i];
+            slack = s;
+        }
+    }
+    if (task == nullptr)
+        return false;
+
+    // stats
+    unsigned long late = nowTS - task->dueTS;
+    if (late > task->deadline)
+        ++task->missed;
+    if (late > task->worstLate)
+        task->worstLate = late > 0xffff ? 0xffff : late;
+
+    // keep the period steady, but do not try to catch up missed runs
+    task->dueTS += task->period;
+    if (static_cast<long>(nowTS - task->dueTS) >= 0)
+        task->dueTS = nowTS + task->period;
+
+    unsigned long startUs = micros();
+    task->run();
+    unsigned long us = micros() - startUs;
+    if (us > runMaxUs) {
+        runMaxUs = us > 0xffff ? 0xffff : us;
+        runMaxTask = task - tasks;
+    }
+    return true;
+}
+
+
+// make the task due right now
+void scheduleNow(Task_s& task)
+{
+    task.dueTS = millis();
+}
+
+
+// print stats of the tasks to Serial
+void printTaskStats(const Task_s * tasks, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; ++i)
+        printTaskStat(tasks, i);
+}
+
+
+// print stats of the task i to Serial
+void printTaskStat(const Task_s * tasks, uint8_t i)
+{
+    Serial.print(F("task "));
+    Serial.print(i);
+    Serial.print(F(": missed="));
+    Serial.print(tasks[i].missed);
+    Serial.print(F(" worstLate="));
+    Serial.println(tasks[i].worstLate);
+}
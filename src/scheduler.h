@@ -0,0 +1,64 @@
+/*
+ * cooperative task scheduler
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#pragma once
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include "globals.h"
+
+
+// periodic task, tasks are statically allocated in a table (see main.cpp)
+struct Task_s
+{
+    void (*run)();          // task function
+    uint16_t period;        // run every "period" msec
+    uint16_t deadline;      // run must start within "deadline" msec after being due, or it is counted as missed
+    unsigned long dueTS;    // when the task is due next time (millis())
+    uint16_t missed;        // stats: number of runs started after deadline
+    uint16_t worstLate;     // stats: the worst lateness of the start (msec)
+};
+
+// index of the tasks of the application in tasks[]
+enum TaskId : uint8_t
+{
+    TASK_BUTTONS = 0,
+    TASK_GPS,
+    TASK_TICK,
+    TASK_DISPLAY,
+    TASK_SYNC,
+#if SHELL
+    TASK_SHELL,
+#endif
+    TASKS_COUNT
+};
+
+// tasks of the application (main.cpp)
+extern Task_s tasks[TASKS_COUNT];
+
+// stats: the longest run of a task since the reset by the reader (usec, 0xffff=longer), index of the task
+extern uint16_t runMaxUs;
+extern uint8_t runMaxTask;
+
+
+// run one due task, the one with the nearest deadline
+// returns: true=task was run, false=nothing due
+bool runTasks(Task_s * tasks, uint8_t count);
+// make the task due right now
+void scheduleNow(Task_s& task);
+// print stats of the tasks to Serial
+void printTaskStats(const Task_s * tasks, uint8_t count);
+// print stats of the task i to Serial
+void printTaskStat(const Task_s * tasks, uint8_t i);
+
+
+#endif // __SCHEDULER_H__
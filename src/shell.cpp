@@ -0,0 +1,545 @@
+/*
+ * command shell on the serial console
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+#include <TinyGPSPlus.h>
+#include <SolarCalculator.h>
+
+#include "DateTime.h"
+#include "config.h"
+#include "globals.h"
+#include "log.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "switch.h"
+#include "timesource.h"
+
+#if SHELL
+
+
+// one line of input: command and its arguments separated by spaces
+// every command is answered by "ok" or "err" on the last line (scripts should wait for it)
+constexpr uint8_t shellLineSize = 32;
+// max number of words on the line (command + arguments)
+constexpr uint8_t shellMaxArgs = 3;
+// max number of days printed by "sched"
+constexpr uint8_t shellMaxDays = 31;
+// one line of "sched": date, on-off of every channel
+constexpr uint8_t schedLineLength = 10 + SWITCH_CHANNELS * 12 + 2;
+
+// input line being received, tokenized in place
+char shellLine[shellLineSize];
+// number of chars in shellLine, shellOverflow=line too long, the rest of it is ignored
+uint8_t shellLen = 0;
+constexpr uint8_t shellOverflow = 0xff;
+
+// "sched" in progress, one day is printed per run: days left, the next day (unixtime utc)
+uint8_t schedDaysLeft = 0;
+uint32_t schedDay;
+// "stats" in progress, one line is printed per run: the next line, 0=not running
+uint8_t statsLine = 0;
+
+
+// config fields accessible by get/set
+enum ShellFieldType : uint8_t
+{
+    SF_FLOAT,   // float
+    SF_CHANNEL, // int16_t of the channel, stored multiplied by 10^decimals, name is followed by channel number (1..)
+};
+
+struct ShellField_s
+{
+    const char * name;  // in PROGMEM
+    uint8_t type;       // ShellFieldType
+    uint8_t offset;     // offset in Config_s, or in ChannelConfig_s for SF_CHANNEL
+    uint8_t decimals;   // number of decimal places
+    int16_t min;        // range of the value (in whole units)
+    int16_t max;
+};
+
+const char sfLat[] PROGMEM = "lat";
+const char sfLon[] PROGMEM = "lon";
+const char sfHdop[] PROGMEM = "hdop";
+const char sfAlt[] PROGMEM = "alt";
+const char sfDelay[] PROGMEM = "delay";
+
+const ShellField_s shellFields[] PROGMEM = {
+    {sfLat, SF_FLOAT, offsetof(Config_s, latitude), 6, -90, 90},
+    {sfLon, SF_FLOAT, offsetof(Config_s, longitude), 6, -180, 180},
+    {sfHdop, SF_FLOAT, offsetof(Config_s, hdop), 1, -1, 99},
+    {sfAlt, SF_CHANNEL, offsetof(ChannelConfig_s, sunAltitude_x10), 1, -90, 90},
+    {sfDelay, SF_CHANNEL, offsetof(ChannelConfig_s, timeDelay), 0, 0, 990},
+};
+constexpr uint8_t shellFieldsCount = sizeof(shellFields) / sizeof(shellFields[0]);
+
+
+
+// parse decimal number "[-]123[.456]" into integer multiplied by 10^decimals
+// extra decimal places are cut off
+// returns: true=OK, false=not a number or too long
+bool parseFixed(const char * str, uint8_t decimals, long& value)
+{
+    bool neg = *str == '-';
+    if (neg || *str == '+')
+        ++str;
+
+    long v = 0;
+    int8_t dec = -1; //decimal places read, -1=no decimal point yet
+    uint8_t digits = 0;
+    for (; *str != '\0'; ++str) {
+        if (*str == '.' && dec < 0) {
+            dec = 0;
+            continue;
+        }
+        if (*str < '0' || *str > '9')
+            return false;
+        if (dec >= static_cast<int8_t>(decimals))
+            continue;
+        v = v * 10 + (*str - '0');
+        ++digits;
+        if (dec >= 0)
+            ++dec;
+    }
+    if (digits == 0)
+        return false;
+
+    // scale to the required number of decimal places, 9 digits fit into long
+    if (dec < 0)
+        dec = 0;
+    if (digits + decimals - dec > 9)
+        return false;
+    for (; dec < static_cast<int8_t>(decimals); ++dec)
+        v *= 10;
+
+    value = neg ? -v : v;
+    return true;
+}
+
+
+// 10^n
+long pow10l(uint8_t n)
+{
+    long p = 1;
+    while (n--)
+        p *= 10;
+    return p;
+}
+
+
+// address of the config field
+uint8_t * fieldAddr(const ShellField_s& f, uint8_t ch)
+{
+    if (f.type == SF_CHANNEL)
+        return reinterpret_cast<uint8_t *>(&config.channel[ch]) + f.offset;
+    return reinterpret_cast<uint8_t *>(&config) + f.offset;
+}
+
+
+// print "name=value" of the config field
+void printField(const ShellField_s& f, uint8_t ch)
+{
+    char buf[16];
+    const uint8_t * p = fieldAddr(f, ch);
+    if (f.type == SF_FLOAT)
+        printFixed(buf, lround(*reinterpret_cast<const float *>(p) * pow10l(f.decimals)), f.decimals);
+    else
+        printFixed(buf, *reinterpret_cast<const int16_t *>(p), f.decimals);
+
+    Serial.print(reinterpret_cast<const __FlashStringHelper *>(f.name));
+    if (f.type == SF_CHANNEL)
+        Serial.print(ch + 1);
+    Serial.print('=');
+    Serial.println(buf);
+}
+
+
+// find config field by name, channel fields are "name" (=first channel) or "name1", "name2", ...
+// returns: true=found (copied into f, channel into ch), false=no such field
+bool findField(const char * name, ShellField_s& f, uint8_t& ch)
+{
+    for (uint8_t i = 0; i < shellFieldsCount; ++i) {
+        memcpy_P(&f, &shellFields[i], sizeof(f));
+        size_t n = strlen_P(f.name);
+        if (strncmp_P(name, f.name, n) != 0)
+            continue;
+
+        ch = 0;
+        if (name[n] == '\0')
+            return true;
+        if (f.type == SF_CHANNEL && name[n + 1] == '\0' && name[n] >= '1' && name[n] < '1' + SWITCH_CHANNELS) {
+            ch = name[n] - '1';
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// print "name=value" of a statistic
+void printStat(const __FlashStringHelper * name, unsigned long value)
+{
+    Serial.print(name);
+    Serial.print('=');
+    Serial.println(value);
+}
+
+
+// print time of the day (localtime, incl. delay) as hh:mm
+void printSchedTime(uint32_t utc, uint8_t ch)
+{
+    char buf[12];
+    printTime(buf, localDateTime(DateTime(utc + config.channel[ch].timeDelay)), 2);
+    Serial.print(buf);
+}
+
+
+
+/**** COMMANDS ****/
+
+// get [field] - print one or all config fields
+int cmdGet(uint8_t argc, char * argv[])
+{
+    ShellField_s f;
+    uint8_t ch;
+    if (argc > 1) {
+        if (!findField(argv[1], f, ch))
+            return -1;
+        printField(f, ch);
+        return 0;
+    }
+    for (uint8_t i = 0; i < shellFieldsCount; ++i) {
+        memcpy_P(&f, &shellFields[i], sizeof(f));
+        for (ch = 0; ch < (f.type == SF_CHANNEL ? SWITCH_CHANNELS : 1); ++ch)
+            printField(f, ch);
+    }
+    return 0;
+}
+
+
+// set field value - change config field, saved after a while (or by "save")
+int cmdSet(uint8_t argc, char * argv[])
+{
+    ShellField_s f;
+    uint8_t ch;
+    long v;
+    if (argc < 3 || !findField(argv[1], f, ch) || !parseFixed(argv[2], f.decimals, v))
+        return -1;
+
+    long scale = pow10l(f.decimals);
+    if (v < f.min * scale || v > f.max * scale)
+        return -1;
+
+    uint8_t * p = fieldAddr(f, ch);
+    if (f.type == SF_FLOAT)
+        *reinterpret_cast<float *>(p) = static_cast<float>(v) / scale;
+    else
+        *reinterpret_cast<int16_t *>(p) = v;
+    configChanged();
+
+    printField(f, ch);
+    return 0;
+}
+
+
+// save - write changed config into eeprom now
+int cmdSave(uint8_t argc, char * argv[])
+{
+    return configCommit(true);
+}
+
+
+// sched [days] - print switch times (localtime, incl. delay) for the following days
+// evening ON of each day and morning OFF of the next day, for every channel
+// the days are printed by schedNextDay() in the following runs of shellTask()
+int cmdSched(uint8_t argc, char * argv[])
+{
+    long days = 1;
+    if (argc > 1 && (!parseFixed(argv[1], 0, days) || days < 1 || days > shellMaxDays))
+        return -1;
+
+    DateTime day = rtcCurrentTime();
+    if (day.year() == 2000/*rtc not set*/ || config.hdop < 0.0/*position not valid*/)
+        return -1;
+
+    schedDay = day.unixtime();
+    schedDaysLeft = days;
+    return +1;
+}
+
+
+// print one day of "sched" when it fits into the serial transmit buffer, "ok" after the last one
+// a day takes 2 calcEphemeris() in soft float, all 31 days at once would block loop()
+// for hundreds of msecs (gps chars are lost after ~66ms)
+void schedNextDay()
+{
+    if (Serial.availableForWrite() < schedLineLength)
+        return;
+
+    // one ephemeris per day serves all the channels
+    Ephemeris_s eph[2]; //evening, morning
+    DateTime day(schedDay);
+    calcEphemeris(day, eph[0]);
+    calcEphemeris(day + TimeSpan(86400l), eph[1]);
+
+    char buf[12];
+    printDate(buf, DateTime(eph[0].midnight));
+    Serial.print(buf);
+    for (uint8_t ch = 0; ch < SWITCH_CHANNELS; ++ch) {
+        double altitude = SUNRISESET_STD_ALTITUDE + config.channel[ch].sunAltitude_x10 / 10.0;
+        Serial.print(' ');
+        printSchedTime(sunCrossing(eph[0], altitude, true), ch);
+        Serial.print('-');
+        printSchedTime(sunCrossing(eph[1], altitude, false), ch);
+    }
+    Serial.println();
+
+    schedDay += 86400ul;
+    if (--schedDaysLeft == 0)
+        Serial.println(F("ok"));
+}
+
+
+// sync - resync time and position from gps now (if the signal is sufficient)
+int cmdSync(uint8_t argc, char * argv[])
+{
+    gpsForceSync();
+    scheduleNow(tasks[TASK_SYNC]);
+    return 0;
+}
+
+
+// stats - print the counters
+// the lines are printed by statsNextLine() in the following runs of shellTask()
+int cmdStats(uint8_t argc, char * argv[])
+{
+    statsLine = 1;
+    return +1;
+}
+
+
+// print one line of "stats" when the serial transmit buffer is empty, "ok" after the last one
+// the whole output has ~550 bytes (more with the profiler), printed at once it would block
+// loop() for ~50ms and the gps chars would be lost
+void statsNextLine()
+{
+    // the longest lines (time sources, profiler) take the whole buffer
+    if (Serial.availableForWrite() < SERIAL_TX_BUFFER_SIZE - 1)
+        return;
+
+    // n counts down to the line to print
+    uint8_t n = statsLine++ - 1;
+    if (n-- == 0)
+        printStat(F("uptime"), uptimeSecs);
+    else if (n-- == 0)
+        printStat(F("activePercent"), activePercent);
+    else if (n-- == 0)
+        printStat(F("gpsChars"), gps.charsProcessed());
+    else if (n-- == 0)
+        printStat(F("gpsFailed"), gps.failedChecksum());
+    else if (n-- == 0)
+        printStat(F("gpsPassed"), gps.passedChecksum());
+    else if (n-- == 0)
+        printStat(F("gpsTtff"), gpsTtff);
+    else if (n-- == 0)
+        printStat(F("gpsAided"), gpsAided);
+#if GPS_BACKUP
+    else if (n-- == 0)
+        printStat(F("gpsBackupWrites"), gpsBackupWrites);
+    else if (n-- == 0)
+        printStat(F("gpsRestored"), gpsRestored);
+#endif
+#if DCF77
+    else if (n-- == 0)
+        printStat(F("dcfFrames"), dcfFrames);
+    else if (n-- == 0)
+        printStat(F("dcfErrors"), dcfErrors);
+#endif
+    else if (n-- == 0)
+        printStat(F("configWritesSaved"), configWritesSaved);
+    else if (n-- == 0)
+        printStat(F("buttonLatencyMax"), buttonLatencyMax);
+    else if (n-- == 0)
+        printStat(F("buttonEventsLost"), buttonEventsLost);
+    else if (n-- == 0)
+        printStat(F("switchWakeups"), switchWakeups);
+    else if (n-- == 0)
+        printStat(F("switchWakeupsPerHour"), uptimeSecs ? switchWakeups * 3600ul / uptimeSecs : 0);
+    else if (n-- == 0)
+        printStat(F("switchErrorMax"), switchErrorMax);
+    else if (n-- == 0)
+        printStat(F("logDropped"), logDropped);
+    else if (n-- == 0)
+        printStat(F("eventsDropped"), eventsDropped);
+#if STACK_PAINT
+    else if (n-- == 0)
+        printStat(F("stackMaxUsed"), stackMaxUsed());
+    else if (n-- == 0)
+        printStat(F("stackFree"), stackFree());
+#endif
+#if TELEMETRY
+    else if (n-- == 0)
+        printStat(F("telemetryDropped"), telemetryDropped);
+#endif
+    else if (n < timeSourceStatLines)
+        printTimeSourceStats(n);
+    else if ((n -= timeSourceStatLines) < TASKS_COUNT)
+        printTaskStat(tasks, n);
+#if PROFILER
+    else if ((n -= TASKS_COUNT) <= PROF_SLOTS)
+        profDump(n);
+#endif
+    else {
+        statsLine = 0;
+        Serial.println(F("ok"));
+    }
+}
+
+
+// log [level] - print or set level of the log messages (0=none .. 4=debug)
+int cmdLog(uint8_t argc, char * argv[])
+{
+    long level;
+    if (argc > 1) {
+        if (!parseFixed(argv[1], 0, level) || level < LOG_NONE || level > LOG_DEBUG)
+            return -1;
+        logLevel = level;
+    }
+    printStat(F("log"), logLevel);
+    return 0;
+}
+
+
+int cmdHelp(uint8_t argc, char * argv[]);
+
+
+// table of the commands
+struct ShellCommand_s
+{
+    const char * name;  // in PROGMEM
+    const char * args;  // usage, in PROGMEM
+    int (*run)(uint8_t argc, char * argv[]); // returns: 0=OK, -1=error, +1=continues (prints "ok" itself)
+};
+
+const char scGet[] PROGMEM = "get";
+const char scGetArgs[] PROGMEM = "[lat|lon|hdop|altN|delayN]";
+const char scSet[] PROGMEM = "set";
+const char scSetArgs[] PROGMEM = "<field> <value>";
+const char scSave[] PROGMEM = "save";
+const char scSched[] PROGMEM = "sched";
+const char scSchedArgs[] PROGMEM = "[days]";
+const char scSync[] PROGMEM = "sync";
+const char scStats[] PROGMEM = "stats";
+const char scLog[] PROGMEM = "log";
+const char scLogArgs[] PROGMEM = "[0-4]";
+const char scHelp[] PROGMEM = "help";
+const char scNoArgs[] PROGMEM = "";
+
+const ShellCommand_s shellCommands[] PROGMEM = {
+    {scGet, scGetArgs, cmdGet},
+    {scSet, scSetArgs, cmdSet},
+    {scSave, scNoArgs, cmdSave},
+    {scSched, scSchedArgs, cmdSched},
+    {scSync, scNoArgs, cmdSync},
+    {scStats, scNoArgs, cmdStats},
+    {scLog, scLogArgs, cmdLog},
+    {scHelp, scNoArgs, cmdHelp},
+};
+constexpr uint8_t shellCommandsCount = sizeof(shellCommands) / sizeof(shellCommands[0]);
+
+
+// help - list the commands
+int cmdHelp(uint8_t argc, char * argv[])
+{
+    for (uint8_t i = 0; i < shellCommandsCount; ++i) {
+        Serial.print(reinterpret_cast<const __FlashStringHelper *>(pgm_read_ptr(&shellCommands[i].name)));
+        Serial.print(' ');
+        Serial.println(reinterpret_cast<const __FlashStringHelper *>(pgm_read_ptr(&shellCommands[i].args)));
+    }
+    return 0;
+}
+
+
+
+/**** SHELL ****/
+
+// split the line into words (in place) and run the command
+// returns: 0=OK, -1=error, +1=command continues in the next runs
+int shellExecute(char * line)
+{
+    char * argv[shellMaxArgs];
+    uint8_t argc = 0;
+    for (char * p = line; *p != '\0'; ) {
+        if (*p == ' ' || *p == '\t') {
+            *p++ = '\0';
+            continue;
+        }
+        if (argc == shellMaxArgs)
+            return -1; //too many words
+        argv[argc++] = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t')
+            ++p;
+    }
+    if (argc == 0)
+        return 0; //empty line
+
+    for (uint8_t i = 0; i < shellCommandsCount; ++i) {
+        if (strcmp_P(argv[0], reinterpret_cast<const char *>(pgm_read_ptr(&shellCommands[i].name))) == 0) {
+            auto run = reinterpret_cast<int (*)(uint8_t, char **)>(pgm_read_ptr(&shellCommands[i].run));
+            return run(argc, argv);
+        }
+    }
+    return -1; //unknown command
+}
+
+
+// process characters received on the serial console, run the command when the line is complete
+// never waits for input
+void shellTask()
+{
+    // the command in progress goes first, input waits in the serial buffer
+    if (schedDaysLeft > 0) {
+        schedNextDay();
+        return;
+    }
+    if (statsLine > 0) {
+        statsNextLine();
+        return;
+    }
+
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c == '\r' || c == '\n') {
+            if (shellLen == 0)
+                continue; //empty line or the second char of "\r\n"
+            int err = -1;
+            if (shellLen != shellOverflow) {
+                shellLine[shellLen] = '\0';
+                err = shellExecute(shellLine);
+            }
+            shellLen = 0;
+            if (err <= 0)
+                Serial.println(err == 0 ? F("ok") : F("err"));
+            return; //one command per run, let the other tasks go
+        }
+        if (shellLen == shellOverflow)
+            continue;
+        if (shellLen >= shellLineSize - 1)
+            shellLen = shellOverflow;
+        else
+            shellLine[shellLen++] = c;
+    }
+}
+
+
+#endif // SHELL
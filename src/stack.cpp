@@ -0,0 +1,77 @@
+/*
+ * stack painting - measures the deepest stack use since boot
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+
+#include "globals.h"
+
+
+// ram between the globals and the stack is painted by this value at boot, the stack
+// (incl. interrupts) overwrites it from RAMEND down. the first byte above the globals
+// that is not the paint is the deepest point the stack ever reached
+constexpr uint8_t stackPaintValue = 0xc5;
+
+// end of .bss/.noinit (start of the heap) and the top of the heap, from the linker and malloc()
+extern uint8_t _end;
+extern char * __brkval;
+
+// lowest byte known to be overwritten by the stack, the scan stops at it
+uint8_t * stackMark = reinterpret_cast<uint8_t *>(RAMEND) + 1;
+
+
+
+#if STACK_PAINT
+// paint the free ram in .init3: SP is set, nothing is on the stack yet and no function
+// was called, so the whole area up to RAMEND is free. must not use the stack itself
+void stackPaint() __attribute__((naked, used, section(".init3")));
+void stackPaint()
+{
+    for (uint8_t * p = &_end; p <= reinterpret_cast<uint8_t *>(RAMEND); ++p)
+        *p = stackPaintValue;
+}
+#endif
+
+
+// find the lowest byte overwritten by the stack
+// the paint is scanned up from the heap (malloc'd memory is not the stack) to the last mark,
+// the stack can only have grown down below it since
+uint8_t * stackLowWater()
+{
+    uint8_t * p = __brkval ? reinterpret_cast<uint8_t *>(__brkval) : &_end;
+    while (p < stackMark && *p == stackPaintValue)
+        ++p;
+    stackMark = p;
+    return p;
+}
+
+
+// bytes of the stack used at most since boot (incl. interrupts)
+uint16_t stackMaxUsed()
+{
+    return reinterpret_cast<uint8_t *>(RAMEND) + 1 - stackLowWater();
+}
+
+
+// bytes never touched between the globals (heap) and the deepest stack
+uint16_t stackFree()
+{
+    uint8_t * p = stackLowWater();
+    uint8_t * base = __brkval ? reinterpret_cast<uint8_t *>(__brkval) : &_end;
+    return p > base ? p - base : 0;
+}
+
+
+// size of the globals (.data + .bss + .noinit)
+uint16_t ramStatic()
+{
+    return &_end - reinterpret_cast<uint8_t *>(RAMSTART);
+}
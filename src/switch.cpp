@@ -1,5 +1,5 @@
 /*
- * control the switch
+ * control the switch channels
  *
  * SolarTimer
  * Timer switch for Arduino (fits Arduino Nano) that turns night lights
@@ -12,115 +12,166 @@
  
 #include <Arduino.h>
 
+#include <uRTCLib.h>
+
 #include "DateTime.h"
 #include "config.h"
 #include "globals.h"
+#include "log.h"
+#include "switch.h"
 
 
-// pin for controling the switch (LOW=active, switch is ON)
-constexpr int switchPin = 12;
+// pins of the outputs
+const uint8_t switchPins[SWITCH_CHANNELS] = SWITCH_PINS;
 
-// switch state: true=ON, false=OFF
-bool currentSwitchState = false;
-// planned future switch state: true=ON, false=OFF
-bool newSwitchState = false;
-// if currentSwState!=newSwState, then here is the start of the delay period (millis())
-unsigned long switchDelayStartTS;
+// all the outputs
+Channel_s channels[SWITCH_CHANNELS];
 
+// time of the next switch event of any channel (unixtime utc, incl. delay), 0=evaluate now
+uint32_t nextSwitchUtc = 0;
+// no event is planned (till the next calculation of the switch times)
+constexpr uint32_t noSwitchEvent = 0xfffffffful;
+// set by the interrupt from rtc alarm
+volatile bool switchAlarmFired = false;
 
+// stats: number of evaluations of the channels (events, schedule changes)
+uint16_t switchWakeups = 0;
+// stats: the worst lateness of switching after the event (secs)
+uint16_t switchErrorMax = 0;
 
-// initialize the switch pin for output
-void initSwitch()
-{
-    //this should make the pin being already in HIGH state during the pinmode change to OUTPUT
-    pinMode(switchPin, INPUT_PULLUP);
-    delay(1);
-    pinMode(switchPin, OUTPUT);
-    digitalWrite(switchPin, HIGH); //for sure, but should be already in HIGH state
-}
 
 
-// check switch status
-void checkSwitch(const DateTime& nowUtc)
+#if SWITCH_RTC_ALARM
+// rtc alarm of the next switch event
+void switchAlarmISR()
 {
-    unsigned long nowTS = millis();
+    switchAlarmFired = true;
+}
 
-    // check for desired state
-    bool desiredState = nowUtc >= switchOnTimeUtc && nowUtc < switchOffTimeUtc;
 
-    // if the switch is switched different than desired
-    if (currentSwitchState != desiredState) {
-        if (newSwitchState != desiredState) {
-            // start countdown of time delay
-            switchDelayStartTS = nowTS;
-            newSwitchState = desiredState;
-        }
+// arm rtc alarm 1 for the next switch event
+// alarm flag is cleared, so INT/SQW goes high and the next match makes a falling edge again
+void switchArmAlarm(uint32_t eventUtc)
+{
+    if (eventUtc == noSwitchEvent) {
+        rtc.alarmDisable(URTCLIB_ALARM_1);
     }
     else {
-        // current state is the same as desired. reset any possible future changes
-        newSwitchState = desiredState;
+        DateTime t(eventUtc);
+        rtc.alarmSet(URTCLIB_ALARM_TYPE_1_FIXED_DHMS, t.second(), t.minute(), t.hour(), t.day());
     }
+    rtc.alarmClearFlag(URTCLIB_ALARM_1);
+}
+#endif
+
+
+// initialize the switch pins for output
+void initSwitch()
+{
+    for (uint8_t ch = 0; ch < SWITCH_CHANNELS; ++ch) {
+        //this should make the pin being already in HIGH state during the pinmode change to OUTPUT
+        pinMode(switchPins[ch], INPUT_PULLUP);
+        delay(1);
+        pinMode(switchPins[ch], OUTPUT);
+        digitalWrite(switchPins[ch], HIGH); //for sure, but should be already in HIGH state
+    }
+
+#if SWITCH_RTC_ALARM
+    // INT/SQW is open drain, active low
+    pinMode(SWITCH_ALARM_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(SWITCH_ALARM_PIN), switchAlarmISR, FALLING);
+#endif
+}
+
 
-    // if plan to switch to the new state
-    if (newSwitchState != currentSwitchState) {
-
-        /*Serial.print("desir=");
-        Serial.print(desiredState);
-        Serial.print(", cur=");
-        Serial.print(currentSwitchState);
-        Serial.print(", new=");
-        Serial.print(newSwitchState);
-        Serial.print(", switch delay=");
-        Serial.print(nowTS - switchDelayStartTS);
-        Serial.print(", config delay=");
-        Serial.println(static_cast<unsigned long>(config.switchTimeDelay) * 1000ul);*/
-
-        unsigned long cfgDelay = static_cast<unsigned long>(config.switchTimeDelay) * 1000ul;
-        if (nowTS - switchDelayStartTS >= cfgDelay) {
-            // time delay has elapsed
-            if (newSwitchState) {
-                Serial.println("*switch ON*");
-                digitalWrite(switchPin, LOW); //lights on
+// schedule (or time) has changed, evaluate the channels at the next checkSwitch()
+void switchScheduleChanged()
+{
+    nextSwitchUtc = 0;
+}
+
+
+// check switch status of all the channels
+// channels are evaluated only when the next event is due (or the alarm has fired),
+// otherwise it is one compare per call
+void checkSwitch(const DateTime& nowUtc)
+{
+    uint32_t now = nowUtc.unixtime();
+    if (!switchAlarmFired && now < nextSwitchUtc)
+        return; //nothing to do till the next event
+    switchAlarmFired = false;
+    ++switchWakeups;
+
+    uint32_t next = noSwitchEvent;
+    for (uint8_t ch = 0; ch < SWITCH_CHANNELS; ++ch) {
+        Channel_s& c = channels[ch];
+        long timeDelay = config.channel[ch].timeDelay;
+        uint32_t on = c.onUtc + timeDelay;
+        uint32_t off = c.offUtc + timeDelay;
+
+        bool state = now >= on && now < off;
+        if (state != c.state) {
+            // rtc has resolution of 1 sec, so 0 is on time
+            uint16_t late = 0;
+            if (nextSwitchUtc != 0) {
+                late = now - (state ? on : off);
+                if (late > switchErrorMax)
+                    switchErrorMax = late;
+            }
+
+            if (state) {
+                LOG_I("*switch %u ON* late %u", ch + 1, late);
+                digitalWrite(switchPins[ch], LOW); //lights on
+                logEvent(EV_SWITCH_ON, ch, late);
             }
             else  {
-                Serial.println("*switch OFF*");
-                digitalWrite(switchPin, HIGH); //lights off
+                LOG_I("*switch %u OFF* late %u", ch + 1, late);
+                digitalWrite(switchPins[ch], HIGH); //lights off
+                logEvent(EV_SWITCH_OFF, ch, late);
             }
-            currentSwitchState = newSwitchState;
+            c.state = state;
+        }
+
+        // the nearest future event of the channel
+        if (now < on) {
+            if (on < next)
+                next = on;
+        }
+        else if (now < off) {
+            if (off < next)
+                next = off;
         }
     }
 
-    // inspect real state (LOW=switch is ON)
-    Serial.print(digitalRead(switchPin) ? "OFF" : "ON");
-    Serial.print(" \t");
+    nextSwitchUtc = next;
+#if SWITCH_RTC_ALARM
+    switchArmAlarm(next);
+#endif
+}
+
+
+// inspect real state of the switch (LOW=switch is ON)
+bool switchIsOn(uint8_t ch)
+{
+    return digitalRead(switchPins[ch]) == LOW;
 }
 
 
 // return number of seconds to the nearest switch-ON, negative value=already was switched
-long timeToSwitchOn(const DateTime& nowUtc)
+long timeToSwitchOn(const DateTime& nowUtc, uint8_t ch)
 {
-    if (currentSwitchState == true)
+    const Channel_s& c = channels[ch];
+    if (c.state == true)
         return -1; //already switched on
-    if (newSwitchState == true && currentSwitchState == false) {
-        // the new state is awaited
-        long diff = (millis() - switchDelayStartTS) / 1000ul;
-        return config.switchTimeDelay - diff;
-    }
-    long diff = (switchOnTimeUtc - nowUtc).totalseconds() + config.switchTimeDelay;
-    return diff;
+    return static_cast<long>(c.onUtc - nowUtc.unixtime()) + config.channel[ch].timeDelay;
 }
 
 
 // return number of seconds to the nearest switch-OFF, negative value=already was switched
-long timeToSwitchOff(const DateTime& nowUtc)
+long timeToSwitchOff(const DateTime& nowUtc, uint8_t ch)
 {
-    if (currentSwitchState == false)
+    const Channel_s& c = channels[ch];
+    if (c.state == false)
         return -1; //already switched off
-    if (newSwitchState == false && currentSwitchState == true) {
-        // the new state is awaited
-        long diff = (millis() - switchDelayStartTS) / 1000ul;
-        return config.switchTimeDelay - diff;
-    }
-    long diff = (switchOffTimeUtc - nowUtc).totalseconds() + config.switchTimeDelay;
-    return diff;
+    return static_cast<long>(c.offUtc - nowUtc.unixtime()) + config.channel[ch].timeDelay;
 }
@@ -0,0 +1,79 @@
+/*
+ * switch channels - independent outputs with own solar schedules
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#pragma once
+#ifndef __SWITCH_H__
+#define __SWITCH_H__
+
+#include "DateTime.h"
+
+
+// number of outputs (lamp groups), each one has its own sun altitude and delay in config
+// default is the single relay of the original board, eg. 2 with SWITCH_PINS {12, 11} for a second one
+#ifndef SWITCH_CHANNELS
+#define SWITCH_CHANNELS 1
+#endif
+// pins of the outputs (LOW=active, switch is ON), one for every channel
+#ifndef SWITCH_PINS
+#define SWITCH_PINS {12}
+#endif
+
+// 1=arm DS3231 alarm 1 for the next switch event, its INT/SQW output wired to SWITCH_ALARM_PIN
+// off by default: needs the wire from the rtc, the original board has none
+#ifndef SWITCH_RTC_ALARM
+#define SWITCH_RTC_ALARM 0
+#endif
+// pin with external interrupt (INT0=2, INT1=3)
+#define SWITCH_ALARM_PIN 2
+
+
+// schedule and state of one output
+struct Channel_s
+{
+    uint32_t onUtc;     // switch-ON this/last evening (unixtime utc, without delay)
+    uint32_t offUtc;    // switch-OFF next/this morning (unixtime utc, without delay)
+    bool state;         // switch state: true=ON, false=OFF
+};
+
+// all the outputs
+extern Channel_s channels[SWITCH_CHANNELS];
+
+// time of the next switch event of any channel (unixtime utc, incl. delay)
+extern uint32_t nextSwitchUtc;
+// stats: number of evaluations of the channels (events, schedule changes)
+extern uint16_t switchWakeups;
+// stats: the worst lateness of switching after the event (secs)
+extern uint16_t switchErrorMax;
+
+// schedule (or time) has changed, evaluate the channels at the next checkSwitch()
+void switchScheduleChanged();
+
+
+// solar ephemeris of one day, switch times of all the channels are derived from it (gps.cpp)
+struct Ephemeris_s
+{
+    uint32_t midnight;  // start of the day (unixtime utc)
+    double transit;     // solar noon (hours utc)
+    double sunrise;     // sunrise at standard altitude (hours utc), NaN=polar day/night
+    double sunset;      // sunset at standard altitude (hours utc), NaN=polar day/night
+    double decRise;     // declination of the sun at sunrise (degs)
+    double decSet;      // declination of the sun at sunset (degs)
+};
+
+// calc ephemeris of the day (utc) at the position from config
+void calcEphemeris(const DateTime& day, Ephemeris_s& eph);
+// time when the sun crosses the altitude (unixtime utc)
+// evening - true=descending in the evening, false=ascending in the morning
+uint32_t sunCrossing(const Ephemeris_s& eph, double altitude, bool evening);
+
+
+#endif // __SWITCH_H__
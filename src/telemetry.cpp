@@ -0,0 +1,131 @@
+/*
+ * binary telemetry frames to the serial console
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+
+#include <TinyGPSPlus.h>
+
+#include "DateTime.h"
+#include "config.h"
+#include "globals.h"
+#include "log.h"
+#include "scheduler.h"
+#include "switch.h"
+
+#if TELEMETRY
+
+
+// format version of the frame, increment on every change of Telemetry_s
+constexpr uint8_t telemetryVersion = 7;
+
+// lateness slots in the frame, the same layout with and without SHELL (missing tasks are 0)
+constexpr uint8_t telemetryTasks = 6;
+static_assert(TASKS_COUNT <= telemetryTasks, "more tasks than the lateness slots of the telemetry frame");
+
+// content of the frame (little endian, no padding on avr)
+// keep in sync with tools/telemetry_monitor.py
+struct Telemetry_s
+{
+    uint8_t version;        // telemetryVersion
+    uint32_t utc;           // current time (unixtime)
+    uint8_t relay;          // bit N: switch of channel N is ON
+    uint32_t switchOn;      // next/last switch-ON of the first channel incl. delay (unixtime)
+    uint32_t switchOff;     // next/last switch-OFF of the first channel incl. delay (unixtime)
+    uint16_t hdop;          // hdop*100, 0xffff=invalid
+    uint8_t sats;           // number of satellites, 0xff=invalid
+    uint32_t gpsChars;      // chars processed by TinyGPSPlus
+    uint16_t gpsFailed;     // sentences with failed checksum (lower 16 bits)
+    uint16_t gpsPassed;     // sentences with passed checksum (lower 16 bits)
+    uint16_t worstLate[telemetryTasks]; // the worst lateness of the tasks (msec), TaskId order
+    uint16_t missed;        // runs of all tasks after deadline
+    uint16_t logDropped;    // log messages dropped
+    uint8_t active;         // cpu active (not sleeping) in the last second (%)
+    uint16_t stackUsed;     // deepest stack use since boot (bytes), 0xffff=not measured
+    uint16_t stackFree;     // ram never touched by the stack (bytes), 0xffff=not measured
+    uint16_t runMax;        // the longest task run since the previous frame (usec), 0xffff=longer
+    uint8_t runMaxTask;     // index of that task
+    uint16_t crc;           // crc16 of all above
+};
+
+// number of frames not sent because the serial transmit buffer was full
+uint16_t telemetryDropped = 0;
+
+
+
+// write COBS encoded data to Serial
+// frames are shorter than 254 bytes, so the blocks need not to be split
+void cobsWrite(const uint8_t * data, uint8_t length)
+{
+    uint8_t start = 0;
+    while (start <= length) {
+        // block ends by zero byte or end of data
+        uint8_t end = start;
+        while (end < length && data[end] != 0)
+            ++end;
+        Serial.write(end - start + 1);
+        Serial.write(data + start, end - start);
+        start = end + 1;
+    }
+}
+
+
+// send status frame (COBS encoded, with crc16, delimited by 0x00)
+void sendTelemetry(const DateTime& nowUtc)
+{
+    Telemetry_s t;
+    t.version = telemetryVersion;
+    t.utc = nowUtc.unixtime();
+    t.relay = 0;
+    for (uint8_t ch = 0; ch < SWITCH_CHANNELS; ++ch) {
+        if (switchIsOn(ch))
+            t.relay |= 1 << ch;
+    }
+    t.switchOn = channels[0].onUtc + config.channel[0].timeDelay;
+    t.switchOff = channels[0].offUtc + config.channel[0].timeDelay;
+    t.hdop = gps.hdop.isValid() ? gps.hdop.value() : 0xffff;
+    t.sats = gps.satellites.isValid() ? gps.satellites.value() : 0xff;
+    t.gpsChars = gps.charsProcessed();
+    t.gpsFailed = gps.failedChecksum();
+    t.gpsPassed = gps.passedChecksum();
+    t.missed = 0;
+    for (uint8_t i = 0; i < telemetryTasks; ++i)
+        t.worstLate[i] = 0;
+    for (uint8_t i = 0; i < TASKS_COUNT; ++i) {
+        t.worstLate[i] = tasks[i].worstLate;
+        t.missed += tasks[i].missed;
+    }
+    t.logDropped = logDropped;
+    t.active = activePercent;
+#if STACK_PAINT
+    t.stackUsed = stackMaxUsed();
+    t.stackFree = stackFree();
+#else
+    t.stackUsed = t.stackFree = 0xffff;
+#endif
+    t.runMax = runMaxUs;
+    t.runMaxTask = runMaxTask;
+    runMaxUs = 0;
+    t.crc = crc16(reinterpret_cast<const uint8_t *>(&t), sizeof(t) - sizeof(t.crc));
+
+    // encoded frame is 1 byte longer, plus delimiters on both sides
+    // separating the frame from the text of the log
+    if (Serial.availableForWrite() < static_cast<int>(sizeof(t)) + 3) {
+        ++telemetryDropped;
+        return;
+    }
+    Serial.write(static_cast<uint8_t>(0));
+    cobsWrite(reinterpret_cast<const uint8_t *>(&t), sizeof(t));
+    Serial.write(static_cast<uint8_t>(0));
+}
+
+
+#endif // TELEMETRY
@@ -0,0 +1,102 @@
+/*
+ * time sources - the arbiter sets the rtc from gps or dcf77
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#include <Arduino.h>
+
+#include <uRTCLib.h>
+
+#include "DateTime.h"
+#include "globals.h"
+#include "log.h"
+#include "switch.h"
+#include "timesource.h"
+
+
+// arbiter with the statistics of the sources
+TimeArbiter timeArbiter;
+// last time of setting (or confirming) clocks, 0=never
+unsigned long datetimeSetTS = 0;
+
+// names of the sources for the log
+const char timeSourceNames[TS_COUNT][6] PROGMEM = {"gps", "dcf77"};
+
+
+
+// start with rtc of unknown age
+// rtcValid - false=rtc lost power or is not set, any source may set it
+void timeSourceInit(bool rtcValid)
+{
+    timeArbiter.begin(rtcValid, millis());
+    datetimeSetTS = 0;
+}
+
+
+// the next valid time of the source sets (or confirms) the rtc, even if the rtc is trusted more
+// or it was written shortly
+void timeSourceForce(uint8_t src)
+{
+    timeArbiter.force(static_cast<TimeSource>(src));
+}
+
+
+// time offered by the source, the arbiter decides whether it sets the rtc
+// inputs: score - confidence of the source (0..100), srcUtc - its time, nowUtc - rtc time
+// returns: 0=rtc set, +1=not set (confirmed or rtc is trusted more)
+int timeOffer(uint8_t src, uint8_t score, const DateTime& srcUtc, const DateTime& nowUtc)
+{
+    unsigned long nowTS = millis();
+    long timediff = (srcUtc - nowUtc).totalseconds();
+
+    TimeDecision d = timeArbiter.offer(static_cast<TimeSource>(src), score, timediff, nowTS);
+    if (d == TD_KEEP)
+        return +1;
+    datetimeSetTS = nowTS;
+    if (d == TD_CONFIRM)
+        return +1;
+
+    LOG_I("time: RTC set by %S (score %u), diff %ld sec", timeSourceNames[src], score, timediff);
+    rtc.set(srcUtc.second(), srcUtc.minute(), srcUtc.hour(), srcUtc.dayOfTheWeek(),
+            srcUtc.day(), srcUtc.month(), srcUtc.year() - 2000);
+    rtc.lostPowerClear(); //for sure
+    rtc.refresh();
+    logEvent(EV_RTC_SET, src, constrain(timediff, -32768l, 32767l));
+    switchScheduleChanged(); //time has jumped
+    return 0;
+}
+
+
+// print stats of the sources to Serial
+void printTimeSourceStats(uint8_t line)
+{
+    if (line == 0) {
+        Serial.print(F("rtcScore="));
+        Serial.println(timeArbiter.rtcScore(millis()));
+        return;
+    }
+    if (line == 1) {
+        Serial.print(F("rtcWrites="));
+        Serial.println(timeArbiter.writes);
+        return;
+    }
+    uint8_t i = line - 2;
+    const TimeSourceStats_s& s = timeArbiter.stats[i];
+    Serial.print(F("time "));
+    Serial.print((const __FlashStringHelper *)timeSourceNames[i]);
+    Serial.print(F(": offers="));
+    Serial.print(s.offers);
+    Serial.print(F(" writes="));
+    Serial.print(s.writes);
+    Serial.print(F(" score="));
+    Serial.print(s.lastScore);
+    Serial.print(F(" diff="));
+    Serial.println(s.lastDiff);
+}
@@ -0,0 +1,162 @@
+/*
+ * time source arbiter - decides which source may set the rtc
+ * no Arduino dependency, so the same code runs in tools/timesource_sim.cpp
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ */
+
+#pragma once
+#ifndef __TIMESOURCE_H__
+#define __TIMESOURCE_H__
+
+#include <stdint.h>
+
+
+// every source offers its time with a score 0..100 (0=useless), the rtc has the score of
+// the source that set (or confirmed) it last, decreasing with the estimated drift.
+// the rtc is written only by a source with a better score than the rtc itself
+
+// sources that can set the rtc
+enum TimeSource : uint8_t
+{
+    TS_GPS = 0,
+    TS_DCF77,
+    TS_COUNT,
+};
+
+// lines printed by printTimeSourceStats(): rtc score, rtc writes, one per source
+constexpr uint8_t timeSourceStatLines = 2 + TS_COUNT;
+
+// what the arbiter decided about the offered time
+enum TimeDecision : uint8_t
+{
+    TD_KEEP = 0,        // rtc is trusted more (or rate limited)
+    TD_CONFIRM,         // time matches, rtc confidence is renewed without writing
+    TD_SET,             // write the offered time into rtc
+};
+
+// difference that is worth writing (secs), smaller one only confirms the rtc
+constexpr long timeDiffMin = 2;
+// min time between two rtc writes (msecs), unless the rtc is not valid
+constexpr uint32_t timeWriteInterval = 10ul * 60ul * 1000ul;
+// score of a valid rtc of unknown age (after boot)
+constexpr uint8_t timeRtcBootScore = 30;
+// rtc score drops 1 point per this time (msecs), DS3231 drifts ~0.2 sec/day
+constexpr uint32_t timeRtcAgingMs = 6ul * 3600ul * 1000ul;
+
+
+// score of gps time from its hdop (<0=invalid)
+// the time of the gps receiver is precise with any fix, hdop says how much the fix is trusted
+inline uint8_t timeGpsScore(float hdop)
+{
+    if (hdop < 0.0f || hdop >= 50.0f)
+        return 0;
+    if (hdop >= 9.0f)
+        return 10; //poor, better than nothing
+    return 100 - static_cast<uint8_t>(hdop * 10.0f);
+}
+
+
+// score of dcf77 time from the number of consecutive valid frames
+inline uint8_t timeDcfScore(uint8_t consecutive)
+{
+    if (consecutive < 2)
+        return 0; //one frame may pass parity by chance
+    return consecutive < 4 ? 30 + consecutive * 10 : 70;
+}
+
+
+// statistics of one source
+struct TimeSourceStats_s
+{
+    uint16_t offers;    // times offered
+    uint16_t writes;    // rtc writes
+    int16_t lastDiff;   // difference of the last offer from rtc (secs)
+    uint8_t lastScore;  // score of the last offer
+};
+
+
+// arbiter of the time sources
+struct TimeArbiter
+{
+    uint32_t setMs = 0;         // time of the last rtc set or confirmation (msecs)
+    uint32_t writeMs = 0;       // time of the last rtc write (msecs)
+    uint8_t setScore = 0;       // score of the source at setMs, 0=rtc not valid
+    uint8_t setSource = TS_COUNT; // source that set or confirmed rtc, TS_COUNT=none (boot)
+    uint16_t writes = 0;        // all rtc writes
+    uint8_t forceSource = TS_COUNT; // next valid offer of this source is taken as if rtc was not valid, TS_COUNT=none
+    TimeSourceStats_s stats[TS_COUNT] = {};
+
+    // start with rtc of unknown age
+    // rtcValid - false=rtc lost power or is not set, any source may set it
+    void begin(bool rtcValid, uint32_t nowMs)
+    {
+        setMs = nowMs;
+        setScore = rtcValid ? timeRtcBootScore : 0;
+        setSource = TS_COUNT;
+    }
+
+    // the next offer of the source with a nonzero score sets (or confirms) the rtc,
+    // regardless of the rtc confidence and the write interval
+    void force(TimeSource src)
+    {
+        forceSource = src;
+    }
+
+    // current confidence of the rtc, 0=not valid
+    uint8_t rtcScore(uint32_t nowMs) const
+    {
+        if (setScore == 0)
+            return 0;
+        uint32_t aging = (nowMs - setMs) / timeRtcAgingMs;
+        return aging < setScore ? setScore - aging : 1;
+    }
+
+    // time offered by the source
+    // score - confidence of the source, diff - its time minus rtc time (secs)
+    TimeDecision offer(TimeSource src, uint8_t score, long diff, uint32_t nowMs)
+    {
+        TimeSourceStats_s& s = stats[src];
+        ++s.offers;
+        s.lastDiff = diff < -32768l ? -32768 : diff > 32767l ? 32767 : diff;
+        s.lastScore = score;
+        if (score == 0)
+            return TD_KEEP;
+
+        uint8_t rtc = rtcScore(nowMs);
+        if (forceSource == src) {
+            forceSource = TS_COUNT;
+            rtc = 0;
+        }
+        if ((diff < 0 ? -diff : diff) < timeDiffMin) {
+            if (score < rtc)
+                return TD_KEEP;
+            // source agrees with rtc, its drift estimate starts again
+            setMs = nowMs;
+            setScore = score;
+            setSource = src;
+            return TD_CONFIRM;
+        }
+
+        if (score <= rtc)
+            return TD_KEEP; //rtc is trusted more
+        if (rtc > 0 && writes > 0 && nowMs - writeMs < timeWriteInterval)
+            return TD_KEEP; //rate limit
+
+        setMs = writeMs = nowMs;
+        setScore = score;
+        setSource = src;
+        ++writes;
+        ++s.writes;
+        return TD_SET;
+    }
+};
+
+
+#endif // __TIMESOURCE_H__
@@ -0,0 +1,277 @@
+/*
+ * host harness of the DCF77 decoder (src/dcf77.h)
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ *
+ * feeds the decoder by the same 1.024ms samples as the timer tick on arduino and
+ * accepts the time like dcfSync() does - after two consecutive frames
+ *
+ * build: g++ -O2 -std=c++11 -I../src -o dcf77_sim dcf77_sim.cpp
+ *
+ * usage: dcf77_sim [options]            synthetic signal, prints success rate and
+ *                                        time to the first valid minute
+ *   -r runs       number of runs, each with a random start phase (default 100)
+ *   -m minutes    length of a run (default 10)
+ *   -j msecs      max jitter of the pulse edges (default 10)
+ *   -n spikes     noise spikes per second (default 0)
+ *   -w msecs      max width of a spike (default 20)
+ *   -d percent    chance that a second is lost in a fade (default 0)
+ *   -s seed       random seed
+ *
+ *        dcf77_sim -f file               replay a recording and print decoded minutes,
+ *                                        lines "<level 0/1> <duration msecs>"
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dcf77.h"
+
+
+// options of the synthetic signal
+int runs = 100;
+int minutes = 10;
+int jitterMs = 10;
+double spikesPerSec = 0.0;
+int spikeMs = 20;
+int dropPercent = 0;
+
+
+// random number 0..n-1
+long rnd(long n)
+{
+    return n > 0 ? random() % n : 0;
+}
+
+
+// local time (CET) from minutes since 2000-01-01 00:00
+DcfTime_s civil(uint32_t m)
+{
+    DcfTime_s t;
+    t.minute = m % 60;
+    t.hour = m / 60 % 24;
+    uint32_t days = m / 1440;
+    t.weekday = (days + 5) % 7 + 1; //2000-01-01 was saturday
+    t.year = 0;
+    while (days >= (t.year % 4 == 0 ? 366u : 365u))
+        days -= t.year++ % 4 == 0 ? 366u : 365u;
+    t.month = 1;
+    for (;;) {
+        uint8_t len = t.month == 2 ? (t.year % 4 == 0 ? 29 : 28) : 30 + ((t.month + (t.month >> 3)) & 1);
+        if (days < len)
+            break;
+        days -= len;
+        ++t.month;
+    }
+    t.day = days + 1;
+    t.utcOffset = 1;
+    return t;
+}
+
+
+// store BCD number, returns parity of its bits
+uint8_t putBcd(uint8_t* frame, uint8_t first, uint8_t len, uint8_t value)
+{
+    uint8_t v = (value / 10) << 4 | value % 10, p = 0;
+    for (uint8_t i = 0; i < len; ++i) {
+        frame[first + i] = (v >> i) & 1;
+        p ^= frame[first + i];
+    }
+    return p;
+}
+
+
+// 59 bits of the minute
+void encode(const DcfTime_s& t, uint8_t* frame)
+{
+    memset(frame, 0, 59);
+    for (int i = 1; i < 15; ++i)
+        frame[i] = rnd(2); //weather data
+    frame[18] = 1; //CET
+    frame[20] = 1;
+    frame[28] = putBcd(frame, 21, 7, t.minute);
+    frame[35] = putBcd(frame, 29, 6, t.hour);
+    uint8_t p = putBcd(frame, 36, 6, t.day);
+    p ^= putBcd(frame, 42, 3, t.weekday);
+    p ^= putBcd(frame, 45, 5, t.month);
+    p ^= putBcd(frame, 50, 8, t.year);
+    frame[58] = p;
+}
+
+
+// result of decoding of one sample stream
+struct Result_s
+{
+    int frames;         // complete frames
+    int valid;          // frames decoded to the right time
+    int wrong;          // frames decoded to a wrong time (passed all checks!)
+    int acceptedWrong;  // wrong time accepted after two consecutive frames
+    long firstValidMs;  // time of the first accepted minute, -1=none
+};
+
+
+// decoder with the acceptance of dcfSync()
+struct Receiver
+{
+    Dcf77Decoder dec;
+    uint32_t last = 0;
+    Result_s res = {0, 0, 0, 0, -1};
+
+    // feed one sample at time nowUs, truth = utc minutes expected at the mark (0=unknown)
+    void sample(bool level, long long nowUs, uint32_t truth)
+    {
+        if (!dec.sample(level))
+            return;
+        dec.ready = false;
+        ++res.frames;
+
+        DcfTime_s t;
+        if (dcfDecode(dec.bits, t)) {
+            last = 0;
+            return;
+        }
+        uint32_t m = dcfUtcMinutes(t);
+        if (truth) {
+            if (m == truth)
+                ++res.valid;
+            else
+                ++res.wrong;
+        }
+        else {
+            printf("%8.3f  20%02u-%02u-%02u %02u:%02u UTC+%u\n", nowUs / 1e6,
+                    t.year, t.month, t.day, t.hour, t.minute, t.utcOffset);
+        }
+        if (m == last + 1) {
+            if (truth && m != truth)
+                ++res.acceptedWrong;
+            else if (res.firstValidMs < 0)
+                res.firstValidMs = nowUs / 1000;
+        }
+        last = m;
+    }
+};
+
+
+// one run of the synthetic signal
+Result_s simulate()
+{
+    Receiver rx;
+    uint32_t start = 20u * 525960u + rnd(5u * 525960u); //some minute of 2020-2025
+    long long phaseUs = rnd(60000) * 1000ll; //receiver starts in the middle of a minute
+
+    // pulses of the whole run, [second][start/end] in usecs
+    int secs = (minutes + 1) * 60;
+    long long* edges = new long long[secs * 2];
+    uint8_t frame[59];
+    for (int s = 0; s < secs; ++s) {
+        if (s % 60 == 0)
+            encode(civil(start + s / 60 + 1), frame);
+        int bit = s % 60;
+        long long t0 = s * 1000000ll + (rnd(2 * jitterMs + 1) - jitterMs) * 1000ll;
+        long long w = (bit < 59 && frame[bit] ? 200000ll : 100000ll) + (rnd(2 * jitterMs + 1) - jitterMs) * 1000ll;
+        bool missing = bit == 59 || rnd(100) < dropPercent;
+        edges[2 * s] = missing ? -1 : t0;
+        edges[2 * s + 1] = t0 + w;
+    }
+
+    long long spikeEndUs = -1;
+    for (long long us = phaseUs; us < secs * 1000000ll; us += DCF77_TICK_US) {
+        int s = us / 1000000;
+        bool level = edges[2 * s] >= 0 && us >= edges[2 * s] && us < edges[2 * s + 1];
+
+        // spikes invert the level
+        if (spikeEndUs < us && rnd(1000000) < spikesPerSec * DCF77_TICK_US)
+            spikeEndUs = us + (1 + rnd(spikeMs)) * 1000ll;
+        if (us < spikeEndUs)
+            level = !level;
+
+        // mark of the second 0 carries the minute (utc = cet - 1h)
+        rx.sample(level, us - phaseUs, start + s / 60 - 60);
+    }
+    delete[] edges;
+    return rx.res;
+}
+
+
+// replay a recording
+int replay(const char* name)
+{
+    FILE* f = fopen(name, "r");
+    if (!f) {
+        perror(name);
+        return 1;
+    }
+    Receiver rx;
+    long long nowUs = 0, nextUs = 0;
+    int level, ms;
+    while (fscanf(f, "%d %d", &level, &ms) == 2) {
+        nextUs += ms * 1000ll;
+        for (; nowUs < nextUs; nowUs += DCF77_TICK_US)
+            rx.sample(level != 0, nowUs, 0);
+    }
+    fclose(f);
+    printf("frames %d, first valid minute %s", rx.res.frames, rx.res.firstValidMs < 0 ? "never\n" : "");
+    if (rx.res.firstValidMs >= 0)
+        printf("after %.1f s\n", rx.res.firstValidMs / 1000.0);
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* file = NULL;
+    long seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:m:j:n:w:d:s:f:")) != -1) {
+        switch (opt) {
+        case 'r': runs = atoi(optarg); break;
+        case 'm': minutes = atoi(optarg); break;
+        case 'j': jitterMs = atoi(optarg); break;
+        case 'n': spikesPerSec = atof(optarg); break;
+        case 'w': spikeMs = atoi(optarg); break;
+        case 'd': dropPercent = atoi(optarg); break;
+        case 's': seed = atol(optarg); break;
+        case 'f': file = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-r runs] [-m minutes] [-j jitter] [-n spikes/s] [-w spike-ms] [-d drop%%] [-s seed] | -f file\n", argv[0]);
+            return 2;
+        }
+    }
+    if (file)
+        return replay(file);
+
+    srandom(seed);
+    long frames = 0, valid = 0, wrong = 0, acceptedWrong = 0, synced = 0;
+    double ttfvSum = 0.0, ttfvMax = 0.0;
+    for (int r = 0; r < runs; ++r) {
+        Result_s res = simulate();
+        frames += res.frames;
+        valid += res.valid;
+        wrong += res.wrong;
+        acceptedWrong += res.acceptedWrong;
+        if (res.firstValidMs >= 0) {
+            double s = res.firstValidMs / 1000.0;
+            ++synced;
+            ttfvSum += s;
+            if (s > ttfvMax)
+                ttfvMax = s;
+        }
+    }
+
+    long sent = static_cast<long>(runs) * minutes;
+    printf("runs %d x %d min, jitter %d ms, noise %.2f spikes/s (max %d ms), drops %d%%\n",
+            runs, minutes, jitterMs, spikesPerSec, spikeMs, dropPercent);
+    printf("frames complete %ld, valid %ld (%.1f%% of minutes sent), WRONG %ld, accepted WRONG %ld\n",
+            frames, valid, 100.0 * valid / sent, wrong, acceptedWrong);
+    printf("first valid minute: %ld/%d runs, avg %.1f s, max %.1f s\n",
+            synced, runs, synced ? ttfvSum / synced : 0.0, ttfvMax);
+    return 0;
+}
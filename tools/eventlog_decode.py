@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+#
+# decoder of the SolarTimer event log (see src/eventlog.cpp)
+#
+# SolarTimer
+# Timer switch for Arduino (fits Arduino Nano) that turns night lights
+# (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+# at actual geo position. With GPS and RTC.
+#
+# Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+# https://github.com/solamyl/SolarTimer
+#
+# input is either:
+#  - text captured from the serial console, the part between "eventlog:" and "end"
+#    (printed at startup), one record per line in hex, oldest first
+#  - raw binary image of the eeprom (4096 bytes) or of the log area (1024 bytes)
+#
+# usage: eventlog_decode.py [dump-file] > events.csv   (stdin when no file given)
+#
+
+import csv
+import struct
+import sys
+from datetime import datetime, timezone
+
+# must match eventLogAddr, eventLogSize in src/config.h
+EVENTLOG_ADDR = 0x0200
+EVENTLOG_SIZE = 0x0400
+EEPROM_SIZE = 4096
+
+# struct EventRecord_s: uint32 time, uint8 code, uint8 arg, int16 value (little endian)
+RECORD = struct.Struct('<IBBh')
+LAP_FLAG = 0x80
+
+# must match enum EventCode in src/globals.h
+EVENTS = {
+    1: 'BOOT',
+    2: 'SWITCH_ON',
+    3: 'SWITCH_OFF',
+    4: 'RTC_SET',
+    5: 'RTC_LOST_POWER',
+    6: 'POSITION_SET',
+    7: 'CONFIG_RESET',
+    8: 'GPS_FIX',
+}
+
+
+def from_text(text):
+    """records from the serial console dump, already in chronological order"""
+    data = bytearray()
+    inside = False
+    for line in text.splitlines():
+        line = line.strip()
+        if line == 'eventlog:':
+            inside = True
+            data.clear()  # keep only the last dump
+        elif line == 'end':
+            inside = False
+        elif inside and len(line) == 2 * RECORD.size:
+            data += bytes.fromhex(line)
+    return bytes(data)
+
+
+def from_binary(image):
+    """records from the raw eeprom image, reordered from the oldest one like eventLogInit() does"""
+    if len(image) == EEPROM_SIZE:
+        image = image[EVENTLOG_ADDR:EVENTLOG_ADDR + EVENTLOG_SIZE]
+    count = len(image) // RECORD.size
+    laps = [image[i * RECORD.size + 4] & LAP_FLAG for i in range(count)]
+    head = next((i for i in range(1, count) if laps[i] != laps[0]), 0)
+    start = head * RECORD.size
+    return image[start:count * RECORD.size] + image[:start]
+
+
+def main():
+    raw = open(sys.argv[1], 'rb').read() if len(sys.argv) > 1 else sys.stdin.buffer.read()
+    try:
+        text = raw.decode('ascii')
+        data = from_text(text) if 'eventlog:' in text else from_binary(raw)
+    except UnicodeDecodeError:
+        data = from_binary(raw)
+
+    out = csv.writer(sys.stdout)
+    out.writerow(['utc', 'event', 'arg', 'value'])
+    for time, code, arg, value in RECORD.iter_unpack(data):
+        if time == 0xffffffff:
+            continue  # never written
+        code &= ~LAP_FLAG
+        utc = datetime.fromtimestamp(time, timezone.utc).strftime('%Y-%m-%d %H:%M:%S')
+        out.writerow([utc, EVENTS.get(code, code), arg, value])
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,22 @@
+// host shim of the Arduino core, just enough for the firmware sources used by the host harnesses
+// (tools/journal_sim.cpp), the harness defines millis() and the device objects
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "avr/pgmspace.h"
+
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+unsigned long millis();
+
+struct String
+{
+    String(const char *) {}
+};
@@ -0,0 +1,4 @@
+// host shim, the class is only declared (globals.h)
+#pragma once
+
+class LCDI2C_Generic;
@@ -0,0 +1,19 @@
+// host shim of the Wire library, the harness implements the bus (tools/journal_sim.cpp)
+#pragma once
+#include <Arduino.h>
+
+#define BUFFER_LENGTH 32
+
+class TwoWire
+{
+public:
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t * data, size_t quantity);
+    int available();
+    int read();
+};
+
+extern TwoWire Wire;
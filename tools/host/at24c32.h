@@ -0,0 +1,13 @@
+// host shim of the at24c32 library, the harness implements the memory (tools/journal_sim.cpp)
+#pragma once
+#include <Arduino.h>
+
+class AT24C32
+{
+public:
+    AT24C32(uint8_t) {}
+    void write(uint16_t address, uint8_t data);
+    uint8_t read(uint16_t address);
+    int readBuffer(uint16_t address, uint8_t * data, uint16_t length);
+    int getLastError();
+};
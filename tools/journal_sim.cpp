@@ -0,0 +1,381 @@
+/*
+ * host harness of the config journal in eeprom (src/config.cpp), power cut at every byte
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ *
+ * config.cpp is compiled as it is, against the shims in tools/host/, with a fake AT24C32
+ * (4 KB, page writes roll over inside the 32 byte page) behind Wire and the at24c32 library.
+ * every saveData() is cut by a power loss after each of its bytes, either the rest of the
+ * write is lost, or the byte being written is garbage. after the "reboot" loadData() must
+ * give the new config or the previous one, and the journal must keep working (the next
+ * saveData() is loaded back). scenarios start from a blank eeprom, from config of the single
+ * output firmware at address 0, and from its journal
+ *
+ * build: g++ -O2 -std=c++11 -Wall -Wextra -Ihost -I../src -o journal_sim journal_sim.cpp
+ * usage: journal_sim [-v]      exit code 1 when any check fails
+ */
+
+// host headers first, they keep their own layout
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// avr has no padding, the records are packed the same way on the host
+#pragma pack(push, 1)
+#include "../src/config.cpp"
+#pragma pack(pop)
+
+
+// the eeprom
+constexpr uint16_t eepromBytes = 4096;
+uint8_t mem[eepromBytes];
+
+// bytes programmed before the power cut, -1=no cut
+long cutAfter = -1;
+// true=the byte being written at the cut is garbage, false=it keeps the old value
+bool cutGarbage = false;
+
+struct PowerCut {};
+
+bool verbose = false;
+
+
+// program one byte, the power is cut here when its time comes
+void program(uint16_t addr, uint8_t value)
+{
+    if (cutAfter == 0) {
+        if (cutGarbage)
+            mem[addr % eepromBytes] ^= 0x5a;
+        throw PowerCut();
+    }
+    if (cutAfter > 0)
+        --cutAfter;
+    mem[addr % eepromBytes] = value;
+}
+
+
+// *** shims of the firmware environment ***
+
+unsigned long millisNow = 0;
+unsigned long millis()
+{
+    return ++millisNow;
+}
+
+void logPrint_P(uint8_t level, const char * fmt, ...)
+{
+    if (!verbose)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    printf("  log%u: ", level);
+    vprintf(fmt, ap);
+    printf("\n");
+    va_end(ap);
+}
+
+// i2c bus with the eeprom only, write: 2 address bytes + data (page write)
+uint8_t txAddr, txBuf[BUFFER_LENGTH], txLen;
+uint16_t memPtr;
+uint8_t rxBuf[BUFFER_LENGTH], rxLen, rxPos;
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    txAddr = address;
+    txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (txLen >= sizeof(txBuf))
+        return 0;
+    txBuf[txLen++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t * data, size_t quantity)
+{
+    size_t n = 0;
+    while (n < quantity && write(data[n]))
+        ++n;
+    return n;
+}
+
+uint8_t TwoWire::endTransmission(bool)
+{
+    if (txAddr != eepromI2cAddr)
+        return 2; //nack
+    if (txLen >= 2) {
+        memPtr = (txBuf[0] << 8 | txBuf[1]) % eepromBytes;
+        uint16_t page = memPtr - memPtr % eepromPageSize;
+        for (uint8_t i = 2; i < txLen; ++i)
+            program(page + (memPtr - page + i - 2) % eepromPageSize, txBuf[i]);
+    }
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+    rxLen = rxPos = 0;
+    if (address != eepromI2cAddr)
+        return 0;
+    for (rxLen = 0; rxLen < quantity && rxLen < sizeof(rxBuf); ++rxLen) {
+        rxBuf[rxLen] = mem[memPtr];
+        memPtr = (memPtr + 1) % eepromBytes;
+    }
+    return rxLen;
+}
+
+int TwoWire::available()
+{
+    return rxLen - rxPos;
+}
+
+int TwoWire::read()
+{
+    return rxPos < rxLen ? rxBuf[rxPos++] : -1;
+}
+
+TwoWire Wire;
+
+void AT24C32::write(uint16_t address, uint8_t data)
+{
+    program(address, data);
+}
+
+uint8_t AT24C32::read(uint16_t address)
+{
+    return mem[address % eepromBytes];
+}
+
+int AT24C32::readBuffer(uint16_t address, uint8_t * data, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; ++i)
+        data[i] = mem[(address + i) % eepromBytes];
+    return length;
+}
+
+int AT24C32::getLastError()
+{
+    return 0;
+}
+
+AT24C32 eeprom(eepromI2cAddr);
+
+
+// *** the test ***
+
+// config number n, all the values differ
+Config_s makeConfig(int n)
+{
+    Config_s c;
+    c.latitude = 50.0 + n * 0.001;
+    c.longitude = 14.0 + n * 0.001;
+    c.hdop = 1.0 + n % 7;
+    for (uint8_t ch = 0; ch < SWITCH_CHANNELS; ++ch) {
+        c.channel[ch].sunAltitude_x10 = -20 - n - ch;
+        c.channel[ch].timeDelay = n * 10 + ch;
+    }
+    c.updateCrc();
+    return c;
+}
+
+
+bool sameConfig(const Config_s& a, const Config_s& b)
+{
+    if (a.latitude != b.latitude || a.longitude != b.longitude || a.hdop != b.hdop)
+        return false;
+    for (uint8_t ch = 0; ch < SWITCH_CHANNELS; ++ch) {
+        if (a.channel[ch].sunAltitude_x10 != b.channel[ch].sunAltitude_x10
+                || a.channel[ch].timeDelay != b.channel[ch].timeDelay)
+            return false;
+    }
+    return true;
+}
+
+
+// power up: RAM state of config.cpp is lost, config is loaded from eeprom
+// returns: result of loadData()
+int reboot(Config_s& c)
+{
+    configSlot = 0;
+    configSeq = 0;
+    c = Config_s();
+    return c.loadData();
+}
+
+
+// state of the eeprom before the save, config that must survive the cut (none=blank eeprom)
+struct Expect_s
+{
+    bool valid;
+    Config_s config;
+};
+
+int checks = 0;
+int failed = 0;
+
+void check(bool ok, const char * scenario, int save, long cut, bool garbage, const char * what)
+{
+    ++checks;
+    if (ok)
+        return;
+    ++failed;
+    if (failed <= 20)
+        printf("  FAIL %s: save %d, cut after %ld bytes%s: %s\n", scenario, save, cut,
+                garbage ? " (garbage)" : "", what);
+}
+
+
+// loaded config is the expected one
+bool loadedIs(int result, const Config_s& c, const Expect_s& e)
+{
+    return e.valid ? result == 0 && sameConfig(c, e.config) : result < 0;
+}
+
+
+// run the saves of one scenario, every save cut at every byte
+// returns: number of the cut saves
+int run(const char * name, const Expect_s& initial, int saves)
+{
+    Expect_s prev = initial;
+    uint8_t snapshot[eepromBytes];
+    int cuts = 0;
+
+    for (int i = 0; i < saves; ++i) {
+        memcpy(snapshot, mem, sizeof(mem));
+        Config_s next = makeConfig(i + 1);
+        Expect_s nextExp = {true, next};
+
+        for (long cut = 0; cut <= static_cast<long>(sizeof(ConfigRecord_s)); ++cut) {
+            for (int garbage = 0; garbage < 2; ++garbage) {
+                memcpy(mem, snapshot, sizeof(mem));
+                Config_s c;
+                check(loadedIs(reboot(c), c, prev), name, i, cut, garbage, "previous config before the save");
+
+                // the save, the power is cut after "cut" bytes (the last run is complete)
+                cutAfter = cut < static_cast<long>(sizeof(ConfigRecord_s)) ? cut : -1;
+                cutGarbage = garbage;
+                try {
+                    next.saveData();
+                }
+                catch (const PowerCut&) {
+                    ++cuts;
+                }
+                cutAfter = -1;
+
+                int r = reboot(c);
+                if (cut == static_cast<long>(sizeof(ConfigRecord_s)))
+                    check(loadedIs(r, c, nextExp), name, i, cut, garbage, "new config after the complete save");
+                else
+                    check(loadedIs(r, c, nextExp) || loadedIs(r, c, prev), name, i, cut, garbage,
+                            "neither the new nor the previous config after the cut");
+
+                // the journal goes on after the torn record
+                Config_s after = makeConfig(1000 + i);
+                after.saveData();
+                Expect_s afterExp = {true, after};
+                r = reboot(c);
+                check(loadedIs(r, c, afterExp), name, i, cut, garbage, "next save after the cut is not loaded");
+            }
+        }
+
+        // commit the save for the next round
+        memcpy(mem, snapshot, sizeof(mem));
+        Config_s c;
+        reboot(c);
+        next.saveData();
+        prev = nextExp;
+        if (verbose)
+            printf("  %s: save %d in slot %u, seq %u\n", name, i, configSlot, configSeq);
+    }
+    return cuts;
+}
+
+
+// config of the single output firmware, as it was migrated by loadData()
+Config_s migratedConfig(const ConfigV1_s& v1)
+{
+    Config_s c;
+    c.latitude = v1.latitude;
+    c.longitude = v1.longitude;
+    c.hdop = v1.hdop;
+    c.channel[0].sunAltitude_x10 = v1.switchSunAltitude_x10;
+    c.channel[0].timeDelay = v1.switchTimeDelay;
+    return c;
+}
+
+
+ConfigV1_s makeConfigV1(int n)
+{
+    ConfigV1_s v1;
+    v1.latitude = 49.0 + n * 0.01;
+    v1.longitude = 16.0 + n * 0.01;
+    v1.hdop = 2.5;
+    v1.switchSunAltitude_x10 = -30 - n;
+    v1.switchTimeDelay = 60 + n;
+    v1.crc16 = ::crc16(reinterpret_cast<const uint8_t *>(&v1) + sizeof(v1.crc16), sizeof(v1) - sizeof(v1.crc16));
+    return v1;
+}
+
+
+int main(int argc, char** argv)
+{
+    verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    // saves go twice around the journal
+    const int saves = 2 * configJournalSlots + 1;
+
+    printf("record %u bytes, slot %u bytes, %u slots\n", static_cast<unsigned>(sizeof(ConfigRecord_s)),
+            configSlotSize, configJournalSlots);
+    printf("%-14s %6s %8s %8s  %s\n", "scenario", "saves", "cuts", "checks", "result");
+
+    struct Scenario_s
+    {
+        const char * name;
+        void (*prepare)(Expect_s& e);
+    };
+    const Scenario_s scenarios[] = {
+        {"blank", [](Expect_s& e) {
+            e.valid = false;
+        }},
+        // config stored directly at address 0 by the oldest firmware
+        {"v1-address-0", [](Expect_s& e) {
+            ConfigV1_s v1 = makeConfigV1(1);
+            memcpy(mem, &v1, sizeof(v1));
+            e.valid = true;
+            e.config = migratedConfig(v1);
+        }},
+        // journal of the single output firmware (page slots), the newest record is in slot 2
+        {"v1-journal", [](Expect_s& e) {
+            for (uint8_t slot = 0; slot < 3; ++slot) {
+                JournalRecord_s<ConfigV1_s> rec;
+                rec.seq = 0xfffe + slot; //wraps around
+                rec.data = makeConfigV1(slot);
+                rec.crc = ::crc16(reinterpret_cast<const uint8_t *>(&rec), sizeof(rec) - sizeof(rec.crc));
+                memcpy(mem + configJournalAddr + slot * eepromPageSize, &rec, sizeof(rec));
+            }
+            e.valid = true;
+            e.config = migratedConfig(makeConfigV1(2));
+        }},
+    };
+
+    for (const Scenario_s& sc : scenarios) {
+        memset(mem, 0xff, sizeof(mem));
+        Expect_s initial;
+        sc.prepare(initial);
+        int failedBefore = failed;
+        int checksBefore = checks;
+        int cuts = run(sc.name, initial, saves);
+        printf("%-14s %6d %8d %8d  %s\n", sc.name, saves, cuts, checks - checksBefore,
+                failed == failedBefore ? "ok" : "FAIL");
+    }
+    return failed ? 1 : 0;
+}
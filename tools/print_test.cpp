@@ -0,0 +1,301 @@
+/*
+ * host tests and benchmark of the number formatting (src/printnum.cpp)
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ *
+ * exhaustive equivalence of printInt() and printFixed() against the previous float based
+ * functions (copied below as legacy*), checked for the whole int16 range and for all
+ * coordinates with 4 decimals. printFixed() must match the exact decimal value always,
+ * the legacy printFloat() mismatches are only counted (float rounding)
+ * host time/call is printed too, cycles on the target are printed by PRINT_BENCHMARK=1
+ *
+ * build: g++ -O2 -Wall -Wextra -I../src -o print_test print_test.cpp ../src/printnum.cpp
+ * usage: print_test [-x]      -x = check divmod10() for all 2^32 values (takes a while)
+ *                              exit code 1 when any check fails
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "printnum.h"
+
+
+/**** legacy functions (print.cpp before the fixed-point formatting), int is 16 bit on AVR ****/
+
+int legacyPrintString(char * buf, const char * value, int8_t reserve=0, bool trailingZero=true)
+{
+    int i = 0;
+    while (value[i] != '\0')
+        ++i;
+
+    int r = reserve - i;
+    if (r < 0)
+        r = 0;
+
+    int j = 0;
+    while (j < r)
+        buf[j++] = ' ';
+    while (i > 0) {
+        buf[j] = value[j - r];
+        ++j;
+        --i;
+    }
+
+    if (trailingZero)
+        buf[j] = '\0';
+    return j;
+}
+
+int legacyPrintInt(char * buf, int16_t value, bool forceSign=false, int8_t reserve=0, bool trailingZero=true)
+{
+    bool neg = value < 0;
+    if (neg)
+        value = -value;
+
+    char tmp[12];
+    int i = 0;
+    do {
+        tmp[i++] = '0' + (value % 10);
+        value /= 10;
+    }
+    while (value);
+
+    if (neg)
+        tmp[i++] = '-';
+    else if (forceSign)
+        tmp[i++] = '+';
+
+    int r = reserve - i;
+    if (r < 0)
+        r = 0;
+
+    int j = 0;
+    while (j < r)
+        buf[j++] = ' ';
+    while (i > 0)
+        buf[j++] = tmp[--i];
+
+    if (trailingZero)
+        buf[j] = '\0';
+    return j;
+}
+
+int legacyPrintFloat(char * buf, float value, int8_t precision=1, bool forceSign=false, int8_t reserve=0, bool trailingZero=true)
+{
+    if (isnan(value))
+        return legacyPrintString(buf, "NaN", reserve, trailingZero);
+
+    char tmp[12];
+    int i = 0;
+
+    bool neg = value < 0;
+    if (neg) {
+        value = -value;
+        tmp[i++] = '-';
+    }
+    else if (forceSign) {
+        tmp[i++] = '+';
+    }
+
+    float rounder = 0.5;
+    for (int p = 0; p < precision; p++)
+        rounder /= 10.0;
+    value += rounder;
+
+    int16_t intPart = static_cast<int16_t>(value);
+    value -= intPart;
+
+    i += legacyPrintInt(tmp + i, intPart, false, 0, false);
+
+    int r = reserve - i;
+    if (precision > 0)
+        r -= precision + 1;
+    if (r < 0)
+        r = 0;
+
+    int j = 0;
+    while (j < r)
+        buf[j++] = ' ';
+    while (i > 0) {
+        buf[j] = tmp[j - r];
+        ++j;
+        --i;
+    }
+
+    if (precision > 0) {
+        buf[j++] = '.';
+        do {
+            value *= 10.0;
+            int digit = static_cast<int>(value);
+            buf[j++] = '0' + digit;
+            value -= digit;
+        }
+        while (--precision > 0);
+    }
+
+    if (trailingZero)
+        buf[j] = '\0';
+    return j;
+}
+
+
+/**** checks ****/
+
+int failures = 0;
+
+void fail(const char * what, long value, const char * got, const char * expected)
+{
+    if (++failures <= 20)
+        printf("FAIL %s(%ld): '%s', expected '%s'\n", what, value, got, expected);
+}
+
+
+// exact decimal form of value / 10^decimals, right aligned (the reference)
+void exactFixed(char * buf, long value, int decimals, bool forceSign, int reserve)
+{
+    char tmp[32];
+    long p = 1;
+    for (int i = 0; i < decimals; ++i)
+        p *= 10;
+    long a = labs(value);
+    const char * sign = value < 0 ? "-" : forceSign ? "+" : "";
+    if (decimals)
+        snprintf(tmp, sizeof(tmp), "%s%ld.%0*ld", sign, a / p, decimals, a % p);
+    else
+        snprintf(tmp, sizeof(tmp), "%s%ld", sign, a);
+    snprintf(buf, 32, "%*s", reserve, tmp);
+}
+
+
+// printInt() against legacy for all int16 values, signs and widths
+void checkInt()
+{
+    char a[32], b[32];
+    long n = 0;
+    for (long v = -32767; v <= 32767; ++v) {
+        for (int sign = 0; sign < 2; ++sign) {
+            for (int reserve = 0; reserve <= 8; ++reserve) {
+                int la = printInt(a, v, sign, reserve);
+                int lb = legacyPrintInt(b, v, sign, reserve);
+                if (la != lb || strcmp(a, b))
+                    fail("printInt", v, a, b);
+                ++n;
+            }
+        }
+    }
+    // legacy overflows on -32768 (-value is still negative), the new one prints it
+    printInt(a, -32768);
+    if (strcmp(a, "-32768"))
+        fail("printInt", -32768, a, "-32768");
+    printf("printInt: %ld cases equal to legacy\n", n);
+}
+
+
+// printFixed() against the exact value and legacy printFloat()
+void checkFixed(int decimals, bool forceSign, int reserve, long from, long to)
+{
+    char a[32], b[32], e[32];
+    long n = 0, floatDiffs = 0;
+    float scale = 1.0f;
+    for (int i = 0; i < decimals; ++i)
+        scale *= 10.0f;
+    for (long v = from; v <= to; ++v) {
+        int la = printFixed(a, v, decimals, forceSign, reserve);
+        exactFixed(e, v, decimals, forceSign, reserve);
+        if (la != static_cast<int>(strlen(a)) || strcmp(a, e))
+            fail("printFixed", v, a, e);
+        legacyPrintFloat(b, v / scale, decimals, forceSign, reserve);
+        if (strcmp(a, b) && v != 0)
+            ++floatDiffs;
+        ++n;
+    }
+    printf("printFixed(%d decimals%s): %ld cases exact, legacy printFloat differs in %ld (%.3f%%)\n",
+            decimals, forceSign ? ", sign" : "", n, floatDiffs, 100.0 * floatDiffs / n);
+}
+
+
+// divmod10() against / and %
+void checkDivmod10(bool all)
+{
+    for (uint32_t v = 0; v <= 0xffff; ++v) {
+        uint16_t q = v;
+        uint8_t r = divmod10(q);
+        if (q != v / 10 || r != v % 10)
+            fail("divmod10/16", v, "", "");
+    }
+
+    uint64_t last = all ? 0xffffffffull : 0;
+    uint32_t step = all ? 1 : 0;
+    for (uint64_t v = 0; step && v <= last; v += step) {
+        uint32_t q = v;
+        uint8_t r = divmod10(q);
+        if (q != v / 10 || r != v % 10)
+            fail("divmod10/32", v, "", "");
+    }
+    if (!all) {
+        srandom(1);
+        for (long i = 0; i < 100000000l; ++i) {
+            uint32_t v = i < 1000 ? 0xffffffffu - i : (static_cast<uint32_t>(random()) << 1) ^ random();
+            uint32_t q = v;
+            uint8_t r = divmod10(q);
+            if (q != v / 10 || r != v % 10)
+                fail("divmod10/32", v, "", "");
+        }
+    }
+    printf("divmod10: 16 bit all, 32 bit %s\n", all ? "all" : "1e8 random + top 1000");
+}
+
+
+/**** benchmark ****/
+
+volatile int sink;
+
+double nsPerCall(int (*fn)(char *, long), long from, long to)
+{
+    char buf[32];
+    clock_t t = clock();
+    long n = 0;
+    for (int rep = 0; rep < 20; ++rep) {
+        for (long v = from; v <= to; v += 7) {
+            sink += fn(buf, v);
+            ++n;
+        }
+    }
+    return (clock() - t) * 1e9 / CLOCKS_PER_SEC / n;
+}
+
+int benchLegacy4(char * buf, long v) { return legacyPrintFloat(buf, v / 10000.0f, 4, false, 7); }
+int benchFixed4(char * buf, long v) { return printFixed(buf, v, 4, false, 7); }
+int benchLegacy1(char * buf, long v) { return legacyPrintFloat(buf, v / 10.0f, 1, true, 6); }
+int benchFixed1(char * buf, long v) { return printFixed(buf, v, 1, true, 6); }
+int benchLegacyInt(char * buf, long v) { return legacyPrintInt(buf, v, false, 7); }
+int benchInt(char * buf, long v) { return printInt(buf, v, false, 7); }
+
+
+int main(int argc, char ** argv)
+{
+    bool all = argc > 1 && strcmp(argv[1], "-x") == 0;
+
+    checkInt();
+    checkFixed(1, true, 6, -32768, 32767);      //sun altitude (tenths)
+    checkFixed(4, false, 7, -1800000, 1800000); //coordinates
+    checkFixed(0, false, 0, -100000, 100000);   //shell integers
+    checkDivmod10(all);
+
+    printf("host ns/call: float4 %.1f, fixed4 %.1f, float1s %.1f, fixed1s %.1f, int legacy %.1f, int %.1f\n",
+            nsPerCall(benchLegacy4, -1800000, 1800000), nsPerCall(benchFixed4, -1800000, 1800000),
+            nsPerCall(benchLegacy1, -900, 900), nsPerCall(benchFixed1, -900, 900),
+            nsPerCall(benchLegacyInt, -32767, 32767), nsPerCall(benchInt, -32767, 32767));
+
+    printf("%s\n", failures ? "FAILED" : "all ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+#
+# cycle count and latency baselines of the firmware under simavr (tools/sim_bench.cpp)
+#
+# SolarTimer
+# Timer switch for Arduino (fits Arduino Nano) that turns night lights
+# (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+# at actual geo position. With GPS and RTC.
+#
+# Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+# https://github.com/solamyl/SolarTimer
+#
+# compiles the sketch by arduino-cli with SIM_MARKERS=1, LCD_BENCHMARK=1 and SHELL=1, TELEMETRY=1
+# (the latency run reads the gps counters from the frames), builds sim_bench
+# against simavr, then runs the idle scenario and the --latency scenario:
+#  - without --update both runs are compared with the committed baselines
+#    (tools/sim_baseline.csv, tools/sim_latency.csv), exit code 1 on a regression
+#  - with --update (or when a baseline is missing) the baselines are (re)written
+# the latency run is also gated by --max-latency and --max-lost when they are given
+#
+# needs arduino-cli with the arduino:avr core, g++, libsimavr and libelf
+# usage: sim_baseline.py [--update] [--presses N] [--simavr DIR] [--fqbn FQBN]
+#
+
+import argparse
+import glob
+import os
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+TOOLS = os.path.join(ROOT, 'tools')
+BUILD = os.path.join(ROOT, 'build', 'sim')
+FQBN = 'arduino:avr:nano'
+BASELINE = os.path.join(TOOLS, 'sim_baseline.csv')
+LATENCY = os.path.join(TOOLS, 'sim_latency.csv')
+
+
+def run(cmd):
+    print(' '.join(cmd), file=sys.stderr)
+    try:
+        return subprocess.call(cmd)
+    except FileNotFoundError:
+        print('%s not found' % cmd[0], file=sys.stderr)
+        sys.exit(2)
+
+
+def compile_firmware(fqbn, build):
+    flags = 'compiler.cpp.extra_flags=-DSIM_MARKERS=1 -DLCD_BENCHMARK=1 -DSHELL=1 -DTELEMETRY=1'
+    if run(['arduino-cli', 'compile', '--fqbn', fqbn, '--build-path', build,
+            '--build-property', flags, ROOT]) != 0:
+        sys.exit(2)
+    elf = glob.glob(os.path.join(build, '*.ino.elf'))
+    if not elf:
+        print('no ELF in ' + build, file=sys.stderr)
+        sys.exit(2)
+    return elf[0]
+
+
+def build_bench(simavr, build):
+    exe = os.path.join(build, 'sim_bench')
+    if run(['g++', '-O2', '-std=c++11', '-Wall', '-Wextra', '-I' + simavr, '-o', exe,
+            os.path.join(TOOLS, 'sim_bench.cpp'), '-lsimavr', '-lelf']) != 0:
+        sys.exit(2)
+    return exe
+
+
+def scenario(exe, elf, args, baseline, update):
+    """one sim_bench run, returns its exit code"""
+    if update or not os.path.exists(baseline):
+        print('writing ' + os.path.relpath(baseline, ROOT), file=sys.stderr)
+        return run([exe] + args + ['--csv', baseline, elf])
+    return run([exe] + args + ['--compare', baseline, elf])
+
+
+def main():
+    ap = argparse.ArgumentParser(description='SolarTimer simavr baselines')
+    ap.add_argument('--update', action='store_true', help='rewrite the baselines')
+    ap.add_argument('--presses', type=int, default=100, help='button presses of the latency run')
+    ap.add_argument('--max-latency', help='p99 press to lcd limit (ms)')
+    ap.add_argument('--max-lost', help='lost gps bytes limit')
+    ap.add_argument('--tolerance', default='2', help='allowed growth of a median (%%)')
+    ap.add_argument('--simavr', default='/usr/include/simavr', help='simavr headers')
+    ap.add_argument('--fqbn', default=FQBN, help='board (default %s)' % FQBN)
+    ap.add_argument('--build-path', default=BUILD, help='arduino-cli build directory')
+    args = ap.parse_args()
+
+    os.makedirs(args.build_path, exist_ok=True)
+    elf = compile_firmware(args.fqbn, args.build_path)
+    exe = build_bench(args.simavr, args.build_path)
+
+    idle = scenario(exe, elf, ['--tolerance', args.tolerance], BASELINE, args.update)
+    gates = ['--latency', str(args.presses)]
+    if args.max_latency:
+        gates += ['--max-latency', args.max_latency]
+    if args.max_lost:
+        gates += ['--max-lost', args.max_lost]
+    latency = scenario(exe, elf, ['--tolerance', args.tolerance] + gates, LATENCY, args.update)
+    sys.exit(max(idle, latency))
+
+
+if __name__ == '__main__':
+    main()
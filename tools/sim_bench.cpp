@@ -0,0 +1,814 @@
+/*
+ * cycle counts of the real firmware under simavr (ATmega328P at 16MHz)
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ *
+ * runs the firmware ELF built with SIM_MARKERS=1 (see src/profiler.h): every PROF_BEGIN/PROF_END
+ * writes the slot into GPIOR0, the write is caught here and the cycles between the begin and
+ * the end of the slot are collected (incl. interrupts that hit it, like on the real board)
+ * stub peripherals:
+ *  - DS3231 rtc (i2c 0x68), time runs with the simulated cycles
+ *  - AT24C32 eeprom (i2c 0x57), empty (0xff) at start, so the config is reset at boot
+ *  - PCF8574 lcd backpack (i2c 0x27), bytes and transfers are only counted
+ *  - gps: GGA+RMC with a fix once per second, bit by bit at 9600 baud to pin 4 (SoftwareSerial)
+ *  - buttons released, dcf77 receiver without signal, Serial output counted (--log prints it)
+ * the rtc alarm (INT0) is not emulated
+ *
+ * firmware built with LCD_BENCHMARK=1 too: bytes on the wire (address bytes incl.) of both paths
+ * of lcdBenchmark() at boot are counted between its markers and printed per line
+ *
+ * results are printed as a table and written to --csv (name,count,min,p50,p90,p99,max,mean),
+ * --compare reads such a file of an older run and fails when a median grew over --tolerance
+ *
+ * --latency N runs the worst case scenario instead of the idle one: nmea is sent continuously
+ * (no gaps) and N presses of "+" are timed from -16 to +45 ms around the tick. every release
+ * changes the config, so each press lands on a tick with a forced calculateSwitchTimes() and
+ * a full screen refresh. the latency is from the press edge to the first lcd byte written
+ * after handleButtons() could see the event (debounce done). lost gps bytes = bytes sent minus
+ * gps chars processed (telemetry) after the stream is stopped and drained
+ *
+ * firmware: arduino-cli compile --fqbn arduino:avr:nano --build-path build/sim
+ *               --build-property "compiler.cpp.extra_flags=-DSIM_MARKERS=1 -DLCD_BENCHMARK=1 -DSHELL=1 -DTELEMETRY=1" .
+ * build:    g++ -O2 -std=c++11 -Wall -Wextra -I/usr/include/simavr -o sim_bench sim_bench.cpp -lsimavr -lelf
+ * usage:    sim_bench [--secs N] [--csv FILE] [--compare FILE] [--tolerance PCT] [--log]
+ *               [--latency N [--max-latency MS] [--max-lost N]] firmware.elf
+ *           exit code 1 when --compare finds a regression or a latency/lost gate is exceeded,
+ *           2 when the simulation fails
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "avr_ioport.h"
+#include "avr_twi.h"
+#include "avr_uart.h"
+}
+
+
+constexpr uint32_t cpuHz = 16000000ul;
+// GPIOR0 in the data space (io 0x1e)
+constexpr avr_io_addr_t gpior0Addr = 0x3e;
+// true time at the start of the simulation (2025-06-21 12:00:00 utc)
+constexpr time_t simEpoch = 1750507200;
+
+// must match enum ProfSlot in src/profiler.h
+const char * const slotNames[] = {
+    "gpsSync", "calc", "switch", "display", "buttons", "gpsDrain", "localTime", "loop",
+};
+constexpr uint8_t slotCount = sizeof(slotNames) / sizeof(slotNames[0]);
+
+avr_t * avr = nullptr;
+
+// latency scenario hooks, defined below
+void latencyLcdByte();
+void latencyMarker(uint8_t slot, bool end, avr_cycle_count_t begin);
+
+
+// true time of the simulation (secs)
+double simSecs()
+{
+    return static_cast<double>(avr->cycle) / cpuHz;
+}
+
+
+/**** i2c devices ****/
+
+// slave on the bus, addr is the 7-bit address
+struct I2cDevice
+{
+    uint8_t addr;
+    explicit I2cDevice(uint8_t a) : addr(a) {}
+    virtual ~I2cDevice() {}
+    virtual void start(bool) {}
+    virtual void write(uint8_t) {}
+    virtual uint8_t read() { return 0xff; }
+    virtual void stop() {}
+};
+
+
+// DS3231: register pointer, time registers computed from the simulated time when read
+struct Ds3231 : I2cDevice
+{
+    uint8_t regs[0x13] = {};
+    uint8_t ptr = 0;
+    bool first = false;
+    bool timeWritten = false;
+    double offset = simEpoch; // rtc time minus simSecs()
+
+    Ds3231() : I2cDevice(0x68) { regs[0x0e] = 0x1c; }
+
+    static uint8_t bcd(int v) { return (v / 10) << 4 | (v % 10); }
+    static int unbcd(uint8_t v) { return (v >> 4) * 10 + (v & 0x0f); }
+
+    void start(bool read) override
+    {
+        first = !read;
+        if (!read)
+            return;
+        time_t t = static_cast<time_t>(floor(offset + simSecs()));
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        regs[0] = bcd(tm.tm_sec);
+        regs[1] = bcd(tm.tm_min);
+        regs[2] = bcd(tm.tm_hour);
+        regs[3] = tm.tm_wday + 1;
+        regs[4] = bcd(tm.tm_mday);
+        regs[5] = bcd(tm.tm_mon + 1);
+        regs[6] = bcd(tm.tm_year % 100);
+    }
+    void write(uint8_t v) override
+    {
+        if (first) {
+            ptr = v % sizeof(regs);
+            first = false;
+            return;
+        }
+        timeWritten |= ptr < 7;
+        regs[ptr] = v;
+        ptr = (ptr + 1) % sizeof(regs);
+    }
+    uint8_t read() override
+    {
+        uint8_t v = regs[ptr];
+        ptr = (ptr + 1) % sizeof(regs);
+        return v;
+    }
+    void stop() override
+    {
+        if (!timeWritten)
+            return;
+        timeWritten = false;
+        struct tm tm = {};
+        tm.tm_sec = unbcd(regs[0] & 0x7f);
+        tm.tm_min = unbcd(regs[1] & 0x7f);
+        tm.tm_hour = unbcd(regs[2] & 0x3f);
+        tm.tm_mday = unbcd(regs[4] & 0x3f);
+        tm.tm_mon = unbcd(regs[5] & 0x1f) - 1;
+        tm.tm_year = unbcd(regs[6]) + 100;
+        offset = timegm(&tm) - simSecs();
+    }
+};
+
+
+// AT24C32: 2 address bytes (high first), 4096 bytes
+struct At24c32 : I2cDevice
+{
+    uint8_t mem[4096];
+    uint16_t ptr = 0;
+    uint8_t index = 0;
+
+    At24c32() : I2cDevice(0x57) { memset(mem, 0xff, sizeof(mem)); }
+
+    void start(bool read) override
+    {
+        if (!read)
+            index = 0;
+    }
+    void write(uint8_t v) override
+    {
+        if (index < 2)
+            ptr = (index++ == 0 ? v << 8 : ptr | v) & (sizeof(mem) - 1);
+        else
+            mem[ptr++ & (sizeof(mem) - 1)] = v;
+    }
+    uint8_t read() override
+    {
+        return mem[ptr++ & (sizeof(mem) - 1)];
+    }
+};
+
+
+// PCF8574 lcd backpack: every byte written is one state of the lcd pins
+struct Pcf8574Lcd : I2cDevice
+{
+    uint64_t bytes = 0;
+    uint64_t transfers = 0;
+    avr_cycle_count_t lastByteCycle = 0;
+
+    Pcf8574Lcd() : I2cDevice(0x27) {}
+
+    // bytes on the wire, one address byte per transfer
+    uint64_t wireBytes() const { return bytes + transfers; }
+
+    void start(bool) override
+    {
+        ++transfers;
+    }
+
+    void write(uint8_t) override
+    {
+        ++bytes;
+        lastByteCycle = avr->cycle;
+        latencyLcdByte();
+    }
+};
+
+
+Ds3231 rtcDev;
+At24c32 eepromDev;
+Pcf8574Lcd lcdDev;
+I2cDevice * const i2cDevices[] = {&rtcDev, &eepromDev, &lcdDev};
+I2cDevice * i2cSelected = nullptr;
+avr_irq_t * i2cIrq = nullptr;
+
+
+// messages of the twi master (like the i2c_eeprom part of simavr)
+void i2cHook(avr_irq_t *, uint32_t value, void *)
+{
+    avr_twi_msg_irq_t v;
+    v.u.v = value;
+
+    if (v.u.twi.msg & TWI_COND_STOP) {
+        if (i2cSelected)
+            i2cSelected->stop();
+        i2cSelected = nullptr;
+    }
+    if (v.u.twi.msg & TWI_COND_START) {
+        i2cSelected = nullptr;
+        for (I2cDevice * d : i2cDevices) {
+            if (d->addr == v.u.twi.addr >> 1)
+                i2cSelected = d;
+        }
+        if (i2cSelected) {
+            i2cSelected->start(v.u.twi.addr & 1);
+            avr_raise_irq(i2cIrq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, v.u.twi.addr, 1));
+        }
+    }
+    if (!i2cSelected)
+        return;
+    if (v.u.twi.msg & TWI_COND_WRITE) {
+        avr_raise_irq(i2cIrq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, v.u.twi.addr, 1));
+        i2cSelected->write(v.u.twi.data);
+    }
+    if (v.u.twi.msg & TWI_COND_READ)
+        avr_raise_irq(i2cIrq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_READ, v.u.twi.addr, i2cSelected->read()));
+}
+
+
+void i2cAttach()
+{
+    static const char * names[] = {"twi.out", "twi.in"};
+    i2cIrq = avr_alloc_irq(&avr->irq_pool, 0, 2, names);
+    avr_irq_register_notify(i2cIrq + TWI_IRQ_OUTPUT, i2cHook, nullptr);
+    avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), i2cIrq + TWI_IRQ_OUTPUT);
+    avr_connect_irq(i2cIrq + TWI_IRQ_INPUT, avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+}
+
+
+/**** pins ****/
+
+avr_irq_t * pinIrq(char port, int bit)
+{
+    return avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(port), bit);
+}
+
+
+/**** gps: nmea at 9600 baud on pin 4 (PD4) ****/
+
+struct NmeaFeeder
+{
+    double bitCycles = static_cast<double>(cpuHz) / 9600.0;
+    std::string pending;        // bytes to send
+    size_t pos = 0;
+    int bit = -1;               // -1=idle, 0=start bit, 1..8=data, 9=stop bit
+    avr_cycle_count_t charStart = 0;
+    uint64_t sent = 0;          // bytes sent completely
+    bool continuous = false;    // refill when empty, no gaps between the bytes
+    bool stopped = false;       // send nothing more after the current byte
+    avr_irq_t * pin = nullptr;
+};
+
+NmeaFeeder nmea;
+
+
+// append checksum and crlf
+std::string nmeaSentence(const char * body)
+{
+    uint8_t cs = 0;
+    for (const char * p = body; *p; ++p)
+        cs ^= static_cast<uint8_t>(*p);
+    char buf[128];
+    snprintf(buf, sizeof(buf), "$%s*%02X\r\n", body, cs);
+    return buf;
+}
+
+
+// sentences of one second with a fix, true time of the simulation
+std::string nmeaSecond(time_t t)
+{
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char body[100];
+    std::string s;
+    snprintf(body, sizeof(body), "GPGGA,%02d%02d%02d.00,5005.1234,N,01425.5678,E,1,08,0.9,250.0,M,45.0,M,,",
+            tm.tm_hour, tm.tm_min, tm.tm_sec);
+    s += nmeaSentence(body);
+    snprintf(body, sizeof(body), "GPRMC,%02d%02d%02d.00,A,5005.1234,N,01425.5678,E,0.01,0.0,%02d%02d%02d,,,A",
+            tm.tm_hour, tm.tm_min, tm.tm_sec, tm.tm_mday, tm.tm_mon + 1, tm.tm_year % 100);
+    s += nmeaSentence(body);
+    return s;
+}
+
+
+// one bit of the uart frame, returns the cycle of the next bit (0=idle)
+avr_cycle_count_t nmeaBit(avr_t *, avr_cycle_count_t when, void *)
+{
+    NmeaFeeder& f = nmea;
+    if (f.bit < 0) {
+        if (f.stopped)
+            return 0;
+        if (f.pos >= f.pending.size() && f.continuous) {
+            f.pending = nmeaSecond(simEpoch + static_cast<time_t>(simSecs()));
+            f.pos = 0;
+        }
+        if (f.pos >= f.pending.size())
+            return 0;
+        f.bit = 0;
+        f.charStart = when;
+    }
+
+    uint8_t c = f.pending[f.pos];
+    int level = f.bit == 0 ? 0 : f.bit == 9 ? 1 : (c >> (f.bit - 1)) & 1;
+    avr_raise_irq(f.pin, level);
+
+    if (++f.bit > 9) {
+        f.bit = -1;
+        ++f.pos;
+        ++f.sent;
+    }
+    return f.charStart + static_cast<avr_cycle_count_t>(llround(f.bit < 0 ? 10 * f.bitCycles : f.bit * f.bitCycles));
+}
+
+
+// gps receiver output 100ms after every second
+avr_cycle_count_t nmeaSecondTimer(avr_t * avr, avr_cycle_count_t when, void *)
+{
+    if (nmea.continuous || nmea.stopped)
+        return 0;
+    bool idle = nmea.bit < 0 && nmea.pos >= nmea.pending.size();
+    nmea.pending.erase(0, nmea.pos);
+    nmea.pos = 0;
+    nmea.pending += nmeaSecond(simEpoch + static_cast<time_t>(simSecs()));
+    if (idle)
+        avr_cycle_timer_register(avr, 1, nmeaBit, nullptr);
+    return when + cpuHz;
+}
+
+
+/**** Serial output ****/
+
+uint64_t uartBytes = 0;
+bool uartLog = false;
+
+// telemetry frames (COBS, crc16, see src/telemetry.cpp), only the gps counters are used
+constexpr uint8_t telemetryVersion = 7;
+std::vector<uint8_t> uartFrame;
+uint32_t telemetryGpsChars = 0;
+uint16_t telemetryGpsFailed = 0;
+uint32_t telemetryFrames = 0;
+
+
+uint16_t crc16(const uint8_t * data, size_t length)
+{
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= data[i] << 8;
+        for (int b = 0; b < 8; ++b)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+
+void telemetryFrame(const std::vector<uint8_t>& enc)
+{
+    std::vector<uint8_t> raw;
+    for (size_t i = 0; i < enc.size(); ) {
+        uint8_t code = enc[i];
+        if (code == 0 || i + code > enc.size())
+            return;
+        raw.insert(raw.end(), enc.begin() + i + 1, enc.begin() + i + code);
+        i += code;
+        if (i < enc.size())
+            raw.push_back(0);
+    }
+    // version, utc, relay, switchOn, switchOff, hdop, sats, gpsChars (17), gpsFailed (21) ...
+    if (raw.size() < 25 || raw[0] != telemetryVersion)
+        return;
+    if (crc16(raw.data(), raw.size() - 2) != (raw[raw.size() - 2] | raw[raw.size() - 1] << 8))
+        return;
+    memcpy(&telemetryGpsChars, &raw[17], 4);
+    memcpy(&telemetryGpsFailed, &raw[21], 2);
+    ++telemetryFrames;
+}
+
+
+void uartHook(avr_irq_t *, uint32_t value, void *)
+{
+    ++uartBytes;
+    char c = static_cast<char>(value);
+    if (uartLog && (c == '\n' || (c >= 32 && c < 127)))
+        fputc(c, stderr);
+
+    // frames are delimited by zeros, text of the log between them is thrown away
+    if (c == 0) {
+        telemetryFrame(uartFrame);
+        uartFrame.clear();
+    }
+    else if (uartFrame.size() < 256) {
+        uartFrame.push_back(static_cast<uint8_t>(value));
+    }
+}
+
+
+/**** markers ****/
+
+struct Slot_s
+{
+    std::vector<uint32_t> cycles;
+    avr_cycle_count_t begin = 0;
+    bool open = false;
+};
+
+Slot_s slots[slotCount];
+
+// lcdBenchmark() markers, must match src/profiler.h and the rounds of src/lcdfast.cpp
+constexpr uint8_t lcdBenchMarks[] = {0x40, 0x41};
+const char * const lcdBenchNames[] = {"println", "batched"};
+constexpr uint8_t lcdBenchRounds = 10;
+
+struct LcdBench_s
+{
+    uint64_t bytes = 0;         // wire bytes at the begin marker, then between the markers
+    uint64_t transfers = 0;     // the same for the transfers
+    bool done = false;
+};
+
+LcdBench_s lcdBench[2];
+
+
+// GPIOR0 write: slot+1 at the begin, 0x80|(slot+1) at the end
+void markerHook(avr_t * avr, avr_io_addr_t addr, uint8_t v, void *)
+{
+    avr->data[addr] = v;
+    for (uint8_t i = 0; i < 2; ++i) {
+        if ((v & 0x7f) != lcdBenchMarks[i])
+            continue;
+        LcdBench_s& b = lcdBench[i];
+        b.bytes = lcdDev.wireBytes() - (v & 0x80 ? b.bytes : 0);
+        b.transfers = lcdDev.transfers - (v & 0x80 ? b.transfers : 0);
+        b.done = v & 0x80;
+        return;
+    }
+    uint8_t slot = (v & 0x7f) - 1;
+    if (slot >= slotCount)
+        return;
+    Slot_s& s = slots[slot];
+    if (v & 0x80) {
+        if (s.open)
+            s.cycles.push_back(avr->cycle - s.begin - 1); //without the marker instruction
+        s.open = false;
+    }
+    else {
+        s.begin = avr->cycle;
+        s.open = true;
+    }
+    latencyMarker(slot, v & 0x80, s.begin);
+}
+
+
+/**** latency scenario ****/
+
+// must match src/profiler.h
+constexpr uint8_t slotCalc = 1, slotButtons = 4;
+// the button interrupt accepts a level stable for 10 ticks of 1.024ms, sampled every tick
+constexpr avr_cycle_count_t debounceCycles = 11 * 1024 * (cpuHz / 1000000) + 1000;
+constexpr avr_cycle_count_t holdCycles = cpuHz / 1000 * 80;
+
+enum PressState : uint8_t
+{
+    PS_OFF = 0,         // scenario not running
+    PS_WAIT_TICK,       // next press is timed from the next calc
+    PS_SCHEDULED,       // press edge is scheduled
+    PS_DEBOUNCE,        // pressed, waiting for handleButtons() after the debounce
+    PS_WAIT_LCD,        // event handled, waiting for the first lcd byte
+    PS_DONE,            // all presses done, the gps stream is drained
+};
+
+struct Latency_s
+{
+    PressState state = PS_OFF;
+    int presses = 0;            // number of presses to do
+    int done = 0;               // presses made
+    int warmup = 2;             // first presses only light up the backlight, not measured
+    avr_cycle_count_t edge = 0; // cycle of the press edge
+    avr_cycle_count_t end = 0;  // end of the simulation after the drain
+    std::vector<uint32_t> cycles; // press edge to the first lcd byte
+    uint64_t sentAtStop = 0;
+    avr_irq_t * pin = nullptr;  // "+" (pin 8)
+};
+
+Latency_s lat;
+
+
+avr_cycle_count_t pressRelease(avr_t *, avr_cycle_count_t when, void *)
+{
+    avr_raise_irq(lat.pin, 1);
+    if (lat.done >= lat.presses) {
+        nmea.stopped = true;
+        lat.end = when + 2 * cpuHz; //drain, two more telemetry frames
+    }
+    return 0;
+}
+
+
+// start the stream and the presses when the firmware listens to the gps (after setup())
+avr_cycle_count_t latencyStart(avr_t * avr, avr_cycle_count_t, void *)
+{
+    nmea.continuous = true;
+    avr_cycle_timer_register(avr, 1, nmeaBit, nullptr);
+    lat.state = PS_WAIT_TICK;
+    return 0;
+}
+
+
+avr_cycle_count_t pressEdge(avr_t * avr, avr_cycle_count_t when, void *)
+{
+    avr_raise_irq(lat.pin, 0);
+    lat.edge = when;
+    lat.state = PS_DEBOUNCE;
+    ++lat.done;
+    avr_cycle_timer_register(avr, holdCycles, pressRelease, nullptr);
+    return 0;
+}
+
+
+// the tick is found by the calc slot, the press is handled by the buttons slot
+void latencyMarker(uint8_t slot, bool end, avr_cycle_count_t begin)
+{
+    if (slot == slotCalc && !end && lat.state == PS_WAIT_TICK) {
+        // next tick is 1 sec later, sweep the press over its start (4ms steps)
+        long offsetMs = static_cast<long>(lat.done % 16) * 4 - 16;
+        avr_cycle_count_t when = cpuHz + offsetMs * static_cast<long>(cpuHz / 1000) - debounceCycles;
+        avr_cycle_timer_register(avr, when, pressEdge, nullptr);
+        lat.state = PS_SCHEDULED;
+    }
+    if (slot == slotButtons && end && lat.state == PS_DEBOUNCE && begin >= lat.edge + debounceCycles)
+        lat.state = PS_WAIT_LCD;
+}
+
+
+void latencyLcdByte()
+{
+    if (lat.state != PS_WAIT_LCD)
+        return;
+    if (lat.done > lat.warmup)
+        lat.cycles.push_back(avr->cycle - lat.edge);
+    lat.state = lat.done < lat.presses ? PS_WAIT_TICK : PS_DONE;
+}
+
+
+/**** results ****/
+
+struct Result_s
+{
+    std::string name;
+    size_t count;
+    uint32_t min, p50, p90, p99, max;
+    double mean;
+};
+
+
+uint32_t percentile(const std::vector<uint32_t>& sorted, double p)
+{
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+
+std::vector<Result_s> results()
+{
+    std::vector<Result_s> res;
+    for (uint8_t i = 0; i < slotCount; ++i) {
+        std::vector<uint32_t> c = slots[i].cycles;
+        if (c.empty())
+            continue;
+        std::sort(c.begin(), c.end());
+        double sum = 0;
+        for (uint32_t v : c)
+            sum += v;
+        res.push_back({slotNames[i], c.size(), c.front(), percentile(c, 0.5), percentile(c, 0.9),
+                percentile(c, 0.99), c.back(), sum / c.size()});
+    }
+    return res;
+}
+
+
+void writeCsv(const char * path, const std::vector<Result_s>& res)
+{
+    FILE * f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    fprintf(f, "name,count,min,p50,p90,p99,max,mean\n");
+    for (const Result_s& r : res)
+        fprintf(f, "%s,%zu,%u,%u,%u,%u,%u,%.1f\n", r.name.c_str(), r.count, r.min, r.p50, r.p90, r.p99, r.max, r.mean);
+    fclose(f);
+}
+
+
+// compare medians with an older run, returns number of regressions
+int compareCsv(const char * path, const std::vector<Result_s>& res, double tolerance)
+{
+    FILE * f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    int worse = 0;
+    char line[256];
+    printf("\n%-10s %10s %10s %8s\n", "slot", "old p50", "new p50", "change");
+    while (fgets(line, sizeof(line), f)) {
+        char name[32];
+        unsigned p50;
+        if (sscanf(line, "%31[^,],%*u,%*u,%u", name, &p50) != 2)
+            continue; //header
+        for (const Result_s& r : res) {
+            if (r.name != name)
+                continue;
+            double change = p50 ? 100.0 * (static_cast<double>(r.p50) - p50) / p50 : 0.0;
+            bool bad = change > tolerance;
+            worse += bad;
+            printf("%-10s %10u %10u %+7.1f%%%s\n", name, p50, r.p50, change, bad ? "  REGRESSION" : "");
+        }
+    }
+    fclose(f);
+    return worse;
+}
+
+
+/**** main ****/
+
+int main(int argc, char ** argv)
+{
+    double secs = 30;
+    const char * csv = nullptr;
+    const char * compare = nullptr;
+    double tolerance = 2.0;
+    const char * elf = nullptr;
+    double maxLatencyMs = 0;
+    long maxLost = -1;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--secs") && i + 1 < argc)
+            secs = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--csv") && i + 1 < argc)
+            csv = argv[++i];
+        else if (!strcmp(argv[i], "--compare") && i + 1 < argc)
+            compare = argv[++i];
+        else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--log"))
+            uartLog = true;
+        else if (!strcmp(argv[i], "--latency") && i + 1 < argc)
+            lat.presses = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-latency") && i + 1 < argc)
+            maxLatencyMs = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--max-lost") && i + 1 < argc)
+            maxLost = atol(argv[++i]);
+        else
+            elf = argv[i];
+    }
+    if (!elf) {
+        fprintf(stderr, "usage: sim_bench [--secs N] [--csv FILE] [--compare FILE] [--tolerance PCT] [--log]\n"
+                "                 [--latency N [--max-latency MS] [--max-lost N]] firmware.elf\n");
+        return 2;
+    }
+
+    elf_firmware_t fw;
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(elf, &fw) != 0) {
+        fprintf(stderr, "cannot read %s\n", elf);
+        return 2;
+    }
+    avr = avr_make_mcu_by_name("atmega328p");
+    if (!avr) {
+        fprintf(stderr, "simavr has no atmega328p\n");
+        return 2;
+    }
+    avr_init(avr);
+    avr_load_firmware(avr, &fw);
+    avr->frequency = cpuHz;
+
+    // peripherals
+    i2cAttach();
+    avr_register_io_write(avr, gpior0Addr, markerHook, nullptr);
+
+    uint32_t flags = 0;
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uartHook, nullptr);
+
+    // idle levels: buttons released (pins 7, 8, 9), rtc alarm (pin 2) high, no dcf77 pulses (pin 10)
+    avr_raise_irq(pinIrq('D', 7), 1);
+    avr_raise_irq(pinIrq('B', 0), 1);
+    avr_raise_irq(pinIrq('B', 1), 1);
+    avr_raise_irq(pinIrq('D', 2), 1);
+    avr_raise_irq(pinIrq('B', 2), 0);
+    nmea.pin = pinIrq('D', 4);
+    avr_raise_irq(nmea.pin, 1);
+    if (lat.presses > 0) {
+        // boot and the first ticks first, then one press per tick
+        lat.pin = pinIrq('B', 0);
+        avr_cycle_timer_register(avr, 3 * cpuHz, latencyStart, nullptr);
+        secs = std::max(secs, lat.presses + 10.0);
+    }
+    else {
+        avr_cycle_timer_register(avr, cpuHz / 10, nmeaSecondTimer, nullptr);
+    }
+
+    avr_cycle_count_t end = static_cast<avr_cycle_count_t>(secs * cpuHz);
+    while (avr->cycle < end && !(lat.end && avr->cycle >= lat.end)) {
+        int state = avr_run(avr);
+        if (state == cpu_Done || state == cpu_Crashed) {
+            fprintf(stderr, "firmware stopped at %.3f s (state %d, pc 0x%04x)\n", simSecs(), state, avr->pc);
+            return 2;
+        }
+    }
+
+    std::vector<Result_s> res = results();
+    printf("simulated %.1f s, nmea bytes %llu, serial bytes %llu, lcd bytes %llu\n", simSecs(),
+            static_cast<unsigned long long>(nmea.sent), static_cast<unsigned long long>(uartBytes),
+            static_cast<unsigned long long>(lcdDev.bytes));
+    for (uint8_t i = 0; i < 2; ++i) {
+        if (lcdBench[i].done)
+            printf("lcd %s: bytes/line %.1f, transfers/line %.1f\n", lcdBenchNames[i],
+                    static_cast<double>(lcdBench[i].bytes) / lcdBenchRounds,
+                    static_cast<double>(lcdBench[i].transfers) / lcdBenchRounds);
+    }
+    printf("%-10s %7s %9s %9s %9s %9s %9s %11s\n", "slot", "count", "min", "p50", "p90", "p99", "max", "mean [cyc]");
+    for (const Result_s& r : res)
+        printf("%-10s %7zu %9u %9u %9u %9u %9u %11.1f\n", r.name.c_str(), r.count, r.min, r.p50, r.p90, r.p99, r.max, r.mean);
+    if (res.empty())
+        fprintf(stderr, "no markers seen, build the firmware with SIM_MARKERS=1\n");
+
+    int failed = 0;
+    if (lat.presses > 0) {
+        if (lat.state != PS_DONE || !lat.end || avr->cycle < lat.end) {
+            fprintf(stderr, "latency scenario not finished, %d of %d presses\n", lat.done, lat.presses);
+            return 2;
+        }
+        std::vector<uint32_t> c = lat.cycles;
+        std::sort(c.begin(), c.end());
+        double sum = 0;
+        for (uint32_t v : c)
+            sum += v;
+        if (!c.empty())
+            res.push_back({"press", c.size(), c.front(), percentile(c, 0.5), percentile(c, 0.9),
+                    percentile(c, 0.99), c.back(), sum / c.size()});
+        long lost = static_cast<long>(nmea.sent) - static_cast<long>(telemetryGpsChars);
+        res.push_back({"gpsLost", 1, static_cast<uint32_t>(std::max(lost, 0l)), 0, 0, 0, 0, static_cast<double>(lost)});
+
+        const double msPerCycle = 1000.0 / cpuHz;
+        printf("\npress to lcd [ms]: count %zu", c.size());
+        if (!c.empty())
+            printf(", min %.2f, p50 %.2f, p90 %.2f, p99 %.2f, max %.2f", c.front() * msPerCycle,
+                    percentile(c, 0.5) * msPerCycle, percentile(c, 0.9) * msPerCycle,
+                    percentile(c, 0.99) * msPerCycle, c.back() * msPerCycle);
+        printf("\ngps bytes: sent %llu, processed %u, lost %ld, failed checksums %u (telemetry frames %u)\n",
+                static_cast<unsigned long long>(nmea.sent), telemetryGpsChars, lost, telemetryGpsFailed, telemetryFrames);
+
+        if (maxLatencyMs > 0 && (c.empty() || percentile(c, 0.99) * msPerCycle > maxLatencyMs)) {
+            printf("FAIL: p99 latency over %.2f ms\n", maxLatencyMs);
+            ++failed;
+        }
+        if (maxLost >= 0 && (telemetryFrames == 0 || lost > maxLost)) {
+            printf("FAIL: lost gps bytes over %ld\n", maxLost);
+            ++failed;
+        }
+    }
+
+    if (csv)
+        writeCsv(csv, res);
+    if (compare)
+        failed += compareCsv(compare, res, tolerance);
+    if (failed)
+        return 1;
+    return res.empty() ? 2 : 0;
+}
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+#
+# flash/RAM usage of the SolarTimer firmware per source file and per symbol
+#
+# SolarTimer
+# Timer switch for Arduino (fits Arduino Nano) that turns night lights
+# (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+# at actual geo position. With GPS and RTC.
+#
+# Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+# https://github.com/solamyl/SolarTimer
+#
+# compiles the sketch by arduino-cli (avr-gcc), then reads the ELF:
+#  - avr-size -A for the section totals (what the IDE reports)
+#  - avr-nm -S -l for every symbol, its size and the source file from the debug info
+# flash = .text + .data, ram = .data + .bss + .noinit (like the IDE, without the stack)
+# .data addresses start at 0x800000 in the AVR ELF, flash symbols (code, PROGMEM) below it.
+# symbols without debug info (libc, libgcc, vectors) are reported as "(no file)", the rest
+# of the sections (padding, init code) as "(unattributed)".
+#
+# budgets are read from tools/size_budget.txt (one line per file or "total": name flash ram),
+# exit code 1 when any budget is exceeded, 2 when the build fails
+#
+# usage: size_report.py [--elf FILE] [--symbols N] [--budget FILE] [--fqbn FQBN]
+#   with --elf the given ELF is analysed and nothing is compiled
+#
+
+import argparse
+import glob
+import os
+import shutil
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BUILD = os.path.join(ROOT, 'build')
+FQBN = 'arduino:avr:nano'
+
+# AVR ELF address spaces
+DATA_BASE = 0x800000
+EEPROM_BASE = 0x810000
+
+
+def tool(name, tools_dir):
+    """path of avr-nm/avr-size: --tools dir, PATH, or the avr-gcc installed by arduino-cli"""
+    if tools_dir:
+        return os.path.join(tools_dir, name)
+    found = shutil.which(name)
+    if found:
+        return found
+    installed = sorted(glob.glob(os.path.expanduser('~/.arduino15/packages/arduino/tools/avr-gcc/*/bin/' + name)))
+    if installed:
+        return installed[-1]
+    sys.exit('%s not found, use --tools' % name)
+
+
+def compile_sketch(fqbn, build):
+    cmd = ['arduino-cli', 'compile', '--fqbn', fqbn, '--build-path', build, ROOT]
+    print(' '.join(cmd), file=sys.stderr)
+    try:
+        if subprocess.call(cmd, stdout=sys.stderr) != 0:
+            sys.exit(2)
+    except FileNotFoundError:
+        print('arduino-cli not found, use --elf', file=sys.stderr)
+        sys.exit(2)
+    elf = glob.glob(os.path.join(build, '*.ino.elf'))
+    if not elf:
+        print('no ELF in ' + build, file=sys.stderr)
+        sys.exit(2)
+    return elf[0]
+
+
+def section_totals(size, elf):
+    """sizes of .text, .data, .bss (+.noinit) from avr-size -A"""
+    totals = {'text': 0, 'data': 0, 'bss': 0}
+    for line in subprocess.check_output([size, '-A', elf], text=True).splitlines():
+        f = line.split()
+        if len(f) == 3 and f[1].isdigit():
+            if f[0] == '.text':
+                totals['text'] += int(f[1])
+            elif f[0] == '.data':
+                totals['data'] += int(f[1])
+            elif f[0] in ('.bss', '.noinit'):
+                totals['bss'] += int(f[1])
+    return totals
+
+
+def source_name(path):
+    """short name of the source file: src/gps.cpp, TinyGPSPlus/TinyGPS++.cpp, core/wiring.c"""
+    path = path.replace('\\', '/')
+    for mark, prefix in (('/sketch/', ''), ('/libraries/', ''), ('/cores/arduino/', 'core/')):
+        if mark in path:
+            return prefix + path.split(mark, 1)[1]
+    return os.path.basename(path)
+
+
+def symbols(nm, elf):
+    """(name, section, size, file) of every symbol with a size"""
+    out = subprocess.check_output([nm, '-S', '-l', '-C', '--size-sort', elf], text=True)
+    result = []
+    for line in out.splitlines():
+        sym, _, where = line.partition('\t')
+        f = sym.split(None, 3)
+        if len(f) < 4:
+            continue
+        addr, size, kind, name = int(f[0], 16), int(f[1], 16), f[2], f[3]
+        if addr >= EEPROM_BASE:
+            continue
+        if addr < DATA_BASE:
+            section = 'text'
+        else:
+            section = 'bss' if kind in 'bB' else 'data'
+        src = source_name(where.rsplit(':', 1)[0]) if where else '(no file)'
+        result.append((name, section, size, src))
+    return result
+
+
+def read_budget(path):
+    """{name: (flash, ram)}, None=no limit"""
+    budget = {}
+    if not os.path.exists(path):
+        return budget
+    for line in open(path):
+        line = line.split('#', 1)[0].split()
+        if len(line) == 3:
+            flash, ram = (None if v == '-' else int(v) for v in line[1:])
+            budget[line[0]] = (flash, ram)
+    return budget
+
+
+def main():
+    ap = argparse.ArgumentParser(description='SolarTimer flash/RAM report')
+    ap.add_argument('--elf', help='analyse this ELF, do not compile')
+    ap.add_argument('--fqbn', default=FQBN, help='board (default %s)' % FQBN)
+    ap.add_argument('--build-path', default=BUILD, help='arduino-cli build directory')
+    ap.add_argument('--tools', help='directory with avr-nm and avr-size')
+    ap.add_argument('--symbols', type=int, default=30, help='number of the biggest symbols to list')
+    ap.add_argument('--budget', default=os.path.join(ROOT, 'tools', 'size_budget.txt'), help='budget file')
+    args = ap.parse_args()
+
+    elf = args.elf or compile_sketch(args.fqbn, args.build_path)
+    totals = section_totals(tool('avr-size', args.tools), elf)
+    syms = symbols(tool('avr-nm', args.tools), elf)
+
+    # per file, the rest of every section is unattributed
+    files = {}
+    for name, section, size, src in syms:
+        files.setdefault(src, {'text': 0, 'data': 0, 'bss': 0})[section] += size
+    rest = {s: totals[s] - sum(f[s] for f in files.values()) for s in totals}
+    files['(unattributed)'] = {s: max(v, 0) for s, v in rest.items()}
+    files['total'] = totals
+
+    print('%-36s %6s %6s %6s %7s %6s' % ('file', 'text', 'data', 'bss', 'flash', 'ram'))
+    usage = {}
+    for src in sorted(files, key=lambda k: (k == 'total', -files[k]['text'] - files[k]['data'])):
+        f = files[src]
+        usage[src] = (f['text'] + f['data'], f['data'] + f['bss'])
+        if src == 'total':
+            print('-' * 72)
+        print('%-36s %6d %6d %6d %7d %6d' % ((src, f['text'], f['data'], f['bss']) + usage[src]))
+
+    if args.symbols:
+        print()
+        print('%-44s %-5s %6s  %s' % ('symbol', 'sect', 'size', 'file'))
+        for name, section, size, src in sorted(syms, key=lambda s: -s[2])[:args.symbols]:
+            print('%-44s %-5s %6d  %s' % (name[:44], section, size, src))
+
+    over = 0
+    for name, (flash_max, ram_max) in sorted(read_budget(args.budget).items()):
+        flash, ram = usage.get(name, (0, 0))
+        for what, used, limit in (('flash', flash, flash_max), ('ram', ram, ram_max)):
+            if limit is not None and used > limit:
+                print('over budget: %s %s %d > %d' % (name, what, used, limit), file=sys.stderr)
+                over += 1
+    sys.exit(1 if over else 0)
+
+
+if __name__ == '__main__':
+    main()
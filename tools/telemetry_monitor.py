@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+#
+# monitor of the SolarTimer binary telemetry (see src/telemetry.cpp)
+#
+# SolarTimer
+# Timer switch for Arduino (fits Arduino Nano) that turns night lights
+# (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+# at actual geo position. With GPS and RTC.
+#
+# Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+# https://github.com/solamyl/SolarTimer
+#
+# frames are COBS encoded, delimited by 0x00 and protected by crc16 (CCITT 0xffff).
+# everything else on the line is the text log, which is passed through (--log).
+#
+# usage: telemetry_monitor.py [--csv] [--log] [device-or-capture-file]
+#   device (eg. /dev/ttyUSB0 or a pty) is switched to 115200 baud raw mode,
+#   regular file is decoded as fast as possible, stdin when nothing given
+#
+
+import argparse
+import os
+import stat
+import struct
+import sys
+from datetime import datetime, timezone
+
+BAUD = 115200
+
+# struct Telemetry_s, version 7 (little endian, no padding)
+# relay is a bitmask of the channels since version 5 (0/1 of the single output before)
+# lateness has 6 slots since version 7 with any SHELL setting (late_shell=0 when built without)
+TASKS = ('buttons', 'gps', 'tick', 'display', 'sync', 'shell')
+FRAME = struct.Struct('<BIBIIHBIHH%dHHHBHHHBH' % len(TASKS))
+FIELDS = ('version', 'utc', 'relay', 'switch_on', 'switch_off', 'hdop', 'sats',
+          'gps_chars', 'gps_failed', 'gps_passed') + tuple('late_' + t for t in TASKS) + \
+         ('missed', 'log_dropped', 'active', 'stack_used', 'stack_free', 'run_max', 'run_max_task', 'crc')
+VERSION = 7
+
+
+def crc16(data, crc=0xffff):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xffff
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data) + (0 if code > 1 else 1):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def decode(segment):
+    """returns dict of the frame fields, or None when the segment is not a valid frame"""
+    if len(segment) != FRAME.size + 1:
+        return None
+    raw = cobs_decode(segment)
+    if raw is None or len(raw) != FRAME.size:
+        return None
+    if crc16(raw[:-2]) != struct.unpack_from('<H', raw, FRAME.size - 2)[0]:
+        return None
+    frame = dict(zip(FIELDS, FRAME.unpack(raw)))
+    if frame['version'] != VERSION:
+        return None
+    return frame
+
+
+def utc(t):
+    return datetime.fromtimestamp(t, timezone.utc).strftime('%Y-%m-%d %H:%M:%S')
+
+
+def status(f):
+    hdop = '--' if f['hdop'] == 0xffff else '%.1f' % (f['hdop'] / 100)
+    sats = '--' if f['sats'] == 0xff else f['sats']
+    late = ' '.join('%s=%d' % (t, f['late_' + t]) for t in TASKS)
+    relay = ''.join('1' if f['relay'] & (1 << i) else '0' for i in range(8)).rstrip('0') or '0'
+    stack = '--' if f['stack_used'] == 0xffff else '%d/%d' % (f['stack_used'], f['stack_free'])
+    task = TASKS[f['run_max_task']] if f['run_max_task'] < len(TASKS) else f['run_max_task']
+    return ('%s relay=%s on=%s off=%s hdop=%s sats=%s chars=%d fail=%d pass=%d late[ms] %s missed=%d drop=%d active=%d%% stack=%s run[us] %s=%d'
+            % (utc(f['utc']), relay, utc(f['switch_on'])[11:16],
+               utc(f['switch_off'])[11:16], hdop, sats, f['gps_chars'], f['gps_failed'],
+               f['gps_passed'], late, f['missed'], f['log_dropped'], f['active'], stack, task, f['run_max']))
+
+
+def open_input(path):
+    if path is None:
+        return sys.stdin.buffer.raw if hasattr(sys.stdin.buffer, 'raw') else sys.stdin.buffer
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if stat.S_ISCHR(os.fstat(fd).st_mode) and os.isatty(fd):
+        import termios
+        import tty
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = getattr(termios, 'B%d' % BAUD)
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return os.fdopen(fd, 'rb', buffering=0)
+
+
+def main():
+    ap = argparse.ArgumentParser(description='SolarTimer telemetry monitor')
+    ap.add_argument('input', nargs='?', help='serial device, pty or capture file (default stdin)')
+    ap.add_argument('--csv', action='store_true', help='print every frame as a CSV row')
+    ap.add_argument('--log', action='store_true', help='pass the text log through to stderr')
+    args = ap.parse_args()
+
+    src = open_input(args.input)
+    live = not args.csv and sys.stdout.isatty()
+    if args.csv:
+        print(','.join(FIELDS[:-1]))
+
+    frames = bad = 0
+    pending = b''
+    while True:
+        try:
+            chunk = src.read(4096)
+        except OSError:
+            break  # pty closed or the device unplugged
+        if not chunk:
+            break
+        segments = (pending + chunk).split(b'\0')
+        pending = segments.pop()
+        for seg in segments:
+            if not seg:
+                continue
+            f = decode(seg)
+            if f is None:
+                if args.log:
+                    sys.stderr.write(seg.decode('ascii', 'replace'))
+                elif len(seg) == FRAME.size + 1:
+                    bad += 1
+                continue
+            frames += 1
+            if args.csv:
+                print(','.join(str(f[k]) for k in FIELDS[:-1]))
+            elif live:
+                sys.stdout.write('\r\033[K' + status(f))
+                sys.stdout.flush()
+            else:
+                print(status(f))
+
+    if live:
+        print()
+    print('frames=%d bad=%d' % (frames, bad), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+#
+# round-trip test of tools/telemetry_monitor.py over a pty
+#
+# SolarTimer
+# Timer switch for Arduino (fits Arduino Nano) that turns night lights
+# (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+# at actual geo position. With GPS and RTC.
+#
+# Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+# https://github.com/solamyl/SolarTimer
+#
+# synthetic frames are encoded the way src/telemetry.cpp does (crc16, COBS, 0x00 on both
+# sides) and written to the master side of a pty, mixed with the text log, a frame with
+# a broken crc, a frame of another version and a frame split over two writes. the monitor
+# reads the slave side like a serial port, its CSV rows must give back the same values
+#
+# usage: telemetry_test.py      exit code 1 when any check fails
+#
+
+import os
+import select
+import subprocess
+import sys
+import time
+import tty
+
+import telemetry_monitor as tm
+
+MONITOR = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'telemetry_monitor.py')
+
+
+def cobs_encode(data):
+    out = bytearray()
+    block = bytearray()
+    for b in data:
+        if b == 0:
+            out += bytes([len(block) + 1]) + block
+            block = bytearray()
+        else:
+            block.append(b)
+            if len(block) == 254:
+                out += bytes([255]) + block
+                block = bytearray()
+    out += bytes([len(block) + 1]) + block
+    return bytes(out)
+
+
+def encode(values, version=tm.VERSION, break_crc=False):
+    """values without the crc, returns the frame with its delimiters"""
+    raw = tm.FRAME.pack(*((version,) + values[1:] + (0,)))[:-2]
+    crc = tm.crc16(raw) ^ (0x0400 if break_crc else 0)
+    return b'\0' + cobs_encode(raw + crc.to_bytes(2, 'little')) + b'\0'
+
+
+def frame_values(n):
+    """values of frame n, with zero bytes and the 'not measured' markers"""
+    late = tuple((n * 37 + i) % 300 for i in range(len(tm.TASKS)))
+    return ((tm.VERSION, 1760000000 + n, n & 0x03, 1760020000, 1760060000,
+             0xffff if n == 0 else 95 + n, 0xff if n == 0 else 7 + n,
+             n * 65536, n, 256 * n) + late +
+            (n % 2, 0, 60 + n, 0xffff if n == 1 else 700 + n, 0xffff if n == 1 else 900 - n,
+             0xffff if n == 2 else 1000 * n, n % len(tm.TASKS)))
+
+
+def run_monitor(args, chunks, rows):
+    """writes chunks to the pty, waits for the CSV header and rows of the monitor
+    returns: (stdout lines, stderr)"""
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    proc = subprocess.Popen([sys.executable, '-u', MONITOR, '--csv'] + args + [os.ttyname(slave)],
+                            stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    out = b''
+    deadline = time.time() + 10
+
+    def wait_lines(n):
+        nonlocal out
+        while out.count(b'\n') < n and select.select([proc.stdout], [], [], max(0, deadline - time.time()))[0]:
+            data = os.read(proc.stdout.fileno(), 4096)
+            if not data:
+                break
+            out += data
+
+    # the header is printed when the pty is open and set up (setting it up flushes the input)
+    wait_lines(1)
+    for chunk in chunks:
+        os.write(master, chunk)
+        time.sleep(0.05)
+    # the monitor ends when the pty is closed, it must read everything first
+    wait_lines(rows + 1)
+    os.close(slave)
+    os.close(master)
+    try:
+        rest, err = proc.communicate(timeout=10)
+    except subprocess.TimeoutExpired:
+        proc.kill()
+        rest, err = proc.communicate()
+    return (out + rest).decode().splitlines(), err.decode()
+
+
+failed = 0
+
+
+def check(ok, what):
+    global failed
+    print('%-50s %s' % (what, 'ok' if ok else 'FAIL'))
+    if not ok:
+        failed += 1
+
+
+def main():
+    values = [frame_values(n) for n in range(4)]
+    frames = [encode(v) for v in values]
+    log = b'I gps: fix, 7 sats\r\n'
+    split = len(frames[3]) // 2
+    chunks = [
+        b'I setup done\r\n' + frames[0],
+        log + frames[1] + b'D noise \x01\x02\r\n',
+        encode(values[1], break_crc=True),
+        encode(values[2], version=tm.VERSION - 1),
+        frames[2] + log,
+        frames[3][:split],
+        frames[3][split:],
+    ]
+    expect = [','.join(str(x) for x in v) for v in values]
+
+    lines, err = run_monitor([], chunks, len(values))
+    check(lines[:1] == [','.join(tm.FIELDS[:-1])], 'csv header')
+    check(lines[1:] == expect, 'csv rows give back the frame values')
+    check('frames=4 bad=2' in err, 'broken crc and other version counted as bad')
+
+    lines, err = run_monitor(['--log'], chunks, len(values))
+    check(lines[1:] == expect, 'csv rows with the log passed through')
+    check(err.count(log.decode()) == 2 and 'I setup done' in err, 'text log on stderr')
+
+    # the status line of a frame with the markers
+    status = tm.status(tm.decode(frames[0][1:-1]))
+    check('hdop=-- sats=--' in status and 'run[us] buttons=0' in status, 'status of "not measured" values')
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
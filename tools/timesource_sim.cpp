@@ -0,0 +1,201 @@
+/*
+ * host harness of the time source arbiter (src/timesource.h)
+ *
+ * SolarTimer
+ * Timer switch for Arduino (fits Arduino Nano) that turns night lights
+ * (like street lamps or decorative lighting) on/off depending on sunset/sunrise
+ * at actual geo position. With GPS and RTC.
+ *
+ * Copyright (C) 2025 by Štěpán Škrob. Licensed under GNU GPL v3.0 license.
+ * https://github.com/solamyl/SolarTimer
+ *
+ * drives the arbiter by synthetic traces of the sources (one gps offer per second like
+ * gpsSync() in the sync task, one dcf77 offer per minute like dcfSync()) against a drifting
+ * rtc, and checks every scenario for the rtc error and the number of rtc writes
+ *
+ * build: g++ -O2 -std=c++11 -I../src -o timesource_sim timesource_sim.cpp
+ * usage: timesource_sim [-v]      exit code 1 when any scenario fails
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timesource.h"
+
+
+// one scenario of the sources
+struct Scenario_s
+{
+    const char* name;
+    int days;               // length of the run
+    bool rtcValid;          // rtc has valid time at the start
+    double rtcOffset;       // initial rtc error (secs)
+    double rtcPpm;          // rtc drift
+    // gps: fix in the hours [gpsFrom, gpsTo) of every day, hdop in [hdopMin, hdopMax]
+    int gpsFrom, gpsTo;
+    double hdopMin, hdopMax;
+    int gpsColdMinutes;     // first minutes after boot have hdop 20 (poor fix)
+    // dcf77: reception in the hours [dcfFrom, dcfTo) (it wraps over midnight), frame success
+    int dcfFrom, dcfTo;
+    int dcfSuccessPercent;
+    long dcfError;          // error of the dcf77 time (secs), eg. a wrong frame pair
+    // expectations
+    double maxErrorSecs;    // max |rtc error| after the first write/confirmation (timeDiffMin + 1 sec of rounding)
+    double maxWritesPerDay;
+    int minWrites;          // rtc must be written at least this many times
+};
+
+
+const Scenario_s scenarios[] = {
+    // name            days valid offs  ppm  gps        hdop      cold dcf       %   err  maxErr w/day minW
+    {"gps-steady",      30, true,  0.4, 2.0, 0, 24,     0.8, 1.5,  0,  0, 0,     0,  0,   3.0,   0.2,  0},
+    {"gps-fast-rtc",    30, true,  0.0, 20., 0, 24,     0.8, 1.5,  0,  0, 0,     0,  0,   3.0,   2.0,  10},
+    {"gps-1h-daily",    30, true,  0.0, 5.0, 12, 13,    2.0, 3.5,  0,  0, 0,     0,  0,   3.0,   0.2,  0},
+    {"cold-start",       2, false, 0.0, 2.0, 0, 24,     1.0, 1.5,  15, 0, 0,     0,  0,   3.0,   2.0,  1},
+    {"rtc-off-boot",     2, true,  73., 2.0, 0, 24,     1.0, 1.5,  0,  0, 0,     0,  0,   3.0,   1.0,  1},
+    {"dcf-only",        30, true,  30., 5.0, 0, 0,      0.0, 0.0,  0,  20, 6,    80, 0,   3.0,   0.3,  1},
+    {"gps-and-dcf",     30, true,  0.0, 8.0, 10, 11,    3.0, 4.0,  0,  20, 6,    80, 0,   3.0,   0.5,  0},
+    {"dcf-wrong-hour",  10, true,  0.0, 2.0, 0, 24,     0.8, 1.5,  0,  0, 24,    95, 3600, 3.0,  0.2,  0},
+    {"poor-gps-only",    5, false, 0.0, 2.0, 0, 24,     12., 30.,  0,  0, 0,     0,  0,   3.0,   1.0,  1},
+};
+
+
+// random number 0..1
+double rnd()
+{
+    return random() / (RAND_MAX + 1.0);
+}
+
+
+// result of one scenario
+struct Result_s
+{
+    int writes;
+    int writesBySource[TS_COUNT];
+    double maxError;        // after the first write/confirmation
+    long firstSyncSecs;     // -1=never
+};
+
+
+// true when the hour is in [from, to), wraps over midnight
+bool inHours(int hour, int from, int to)
+{
+    return from <= to ? hour >= from && hour < to : hour >= from || hour < to;
+}
+
+
+Result_s run(const Scenario_s& sc, bool verbose)
+{
+    TimeArbiter arb;
+    arb.begin(sc.rtcValid, 0);
+
+    Result_s res;
+    memset(&res, 0, sizeof(res));
+    res.firstSyncSecs = -1;
+
+    const double t0 = 800000000.0; //some true time (secs)
+    double rtc = sc.rtcValid ? t0 + sc.rtcOffset : 0.0; //rtc reading (secs, not rounded)
+    double hdop = sc.hdopMin;
+    uint8_t consecutive = 0; //dcf77 frames
+
+    for (long s = 0; s < sc.days * 86400l; ++s) {
+        double t = t0 + s;
+        uint32_t ms = s * 1000ul;
+        int hour = s / 3600 % 24;
+        rtc += 1.0 + sc.rtcPpm * 1e-6;
+        long rtcSecs = static_cast<long>(floor(rtc));
+
+        // gps once per second, hdop wanders in its range
+        if (inHours(hour, sc.gpsFrom, sc.gpsTo)) {
+            hdop += (rnd() - 0.5) * 0.2;
+            hdop = hdop < sc.hdopMin ? sc.hdopMin : hdop > sc.hdopMax ? sc.hdopMax : hdop;
+            double h = s < sc.gpsColdMinutes * 60l ? 20.0 : hdop;
+            long gps = static_cast<long>(floor(t));
+            TimeDecision d = arb.offer(TS_GPS, timeGpsScore(h), gps - rtcSecs, ms);
+            if (d == TD_SET) {
+                rtc = gps + (t - floor(t)); //rtc.set() restarts the second
+                ++res.writesBySource[TS_GPS];
+                if (verbose)
+                    printf("  %8.3f d: gps set, diff %ld, hdop %.1f\n", s / 86400.0, gps - rtcSecs, h);
+            }
+            if (d != TD_KEEP && res.firstSyncSecs < 0)
+                res.firstSyncSecs = s;
+        }
+
+        // dcf77 once per minute, counting consecutive frames like dcfSync()
+        if (s % 60 == 0) {
+            if (inHours(hour, sc.dcfFrom, sc.dcfTo) && rnd() * 100 < sc.dcfSuccessPercent) {
+                if (consecutive < 0xff)
+                    ++consecutive;
+                long dcf = static_cast<long>(floor(t)) + sc.dcfError;
+                TimeDecision d = arb.offer(TS_DCF77, timeDcfScore(consecutive), dcf - rtcSecs, ms);
+                if (d == TD_SET) {
+                    rtc = dcf + (t - floor(t));
+                    ++res.writesBySource[TS_DCF77];
+                    if (verbose)
+                        printf("  %8.3f d: dcf set, diff %ld, consecutive %u\n", s / 86400.0, dcf - rtcSecs, consecutive);
+                }
+                if (d != TD_KEEP && res.firstSyncSecs < 0)
+                    res.firstSyncSecs = s;
+            }
+            else {
+                consecutive = 0;
+            }
+        }
+
+        if (res.firstSyncSecs >= 0) {
+            double err = fabs(rtc - t);
+            if (err > res.maxError)
+                res.maxError = err;
+        }
+    }
+    res.writes = arb.writes;
+    return res;
+}
+
+
+// forced sync (shell "sync") within the write interval: a normal offer is rate limited,
+// the forced one sets the rtc, the next normal one is rate limited again
+bool forcedSync()
+{
+    TimeArbiter arb;
+    arb.begin(true, 0);
+    bool ok = arb.offer(TS_GPS, timeGpsScore(1.0), 5, 1000) == TD_SET;
+    ok &= arb.offer(TS_GPS, timeGpsScore(0.8), 5, 61000) == TD_KEEP;
+    arb.force(TS_DCF77);
+    ok &= arb.offer(TS_GPS, timeGpsScore(0.8), 5, 62000) == TD_KEEP; //other source forced
+    arb.force(TS_GPS);
+    ok &= arb.offer(TS_GPS, 0, 5, 63000) == TD_KEEP; //invalid offer keeps the force
+    ok &= arb.offer(TS_GPS, timeGpsScore(2.0), 5, 64000) == TD_SET;
+    ok &= arb.offer(TS_GPS, timeGpsScore(0.8), 5, 65000) == TD_KEEP;
+    return ok && arb.writes == 2;
+}
+
+
+int main(int argc, char** argv)
+{
+    bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    srandom(1);
+
+    int failed = 0;
+    printf("%-16s %7s %7s %5s %5s %9s %10s  %s\n", "scenario", "writes", "w/day", "gps", "dcf",
+            "maxErr", "firstSync", "result");
+    for (const Scenario_s& sc : scenarios) {
+        if (verbose)
+            printf("%s:\n", sc.name);
+        Result_s r = run(sc, verbose);
+        double perDay = static_cast<double>(r.writes) / sc.days;
+        bool ok = r.firstSyncSecs >= 0 && r.maxError <= sc.maxErrorSecs
+                && perDay <= sc.maxWritesPerDay && r.writes >= sc.minWrites;
+        failed += !ok;
+        printf("%-16s %7d %7.2f %5d %5d %8.2fs %9lds  %s\n", sc.name, r.writes, perDay,
+                r.writesBySource[TS_GPS], r.writesBySource[TS_DCF77], r.maxError, r.firstSyncSecs,
+                ok ? "ok" : "FAIL");
+    }
+    bool ok = forcedSync();
+    failed += !ok;
+    printf("%-16s %7s %7s %5s %5s %9s %10s  %s\n", "forced-sync", "", "", "", "", "", "", ok ? "ok" : "FAIL");
+    return failed ? 1 : 0;
+}